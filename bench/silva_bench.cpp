@@ -0,0 +1,391 @@
+/**
+ * @file silva_bench.cpp
+ * @brief Microbenchmarks of the Silva ECS
+ *        Every benchmark runs at 1k, 10k, 100k and 1M entities and the
+ *        results are written as JSON, so two versions can be diffed:
+ *
+ *        silva_bench [--filter <substring>] [--sizes 1000,10000] [--out <file>]
+ */
+
+#include "Silva.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Pos {
+    float x, y;
+};
+
+struct Vel {
+    float x, y;
+};
+
+/**
+ * @brief 32 bytes handle with a move constructor that nulls the source,
+ *        the case is_relocatable is for
+ */
+struct Handle {
+    void* handle = nullptr;
+    float data[6] = {};
+
+    Handle() = default;
+    Handle(void* h, const float& v)
+        : handle(h)
+    {
+        data[0] = v;
+    }
+    Handle(const Handle&) = default;
+    Handle(Handle&& other) noexcept
+        : handle(other.handle)
+    {
+        std::copy(other.data, other.data + 6, data);
+        other.handle = nullptr;
+    }
+    Handle& operator=(const Handle&) = default;
+    Handle& operator=(Handle&& other) noexcept
+    {
+        handle = other.handle;
+        std::copy(other.data, other.data + 6, data);
+        other.handle = nullptr;
+        return *this;
+    }
+    ~Handle()
+    {
+        if (handle)
+            asm volatile("" ::: "memory");
+    }
+};
+
+/**
+ * @brief Same as Handle, opted in as relocatable
+ */
+struct RelocatableHandle : Handle {
+    using Handle::Handle;
+};
+
+static_assert(sizeof(Handle) == 32 && sizeof(RelocatableHandle) == 32);
+
+} // namespace
+
+template <>
+struct silva::is_relocatable<RelocatableHandle> : std::true_type {
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Keeps a value from being optimized away
+ */
+volatile double sink = 0;
+
+/**
+ * @brief The timings of one benchmark at one size
+ */
+struct Result {
+    std::string name;
+    std::size_t entities = 0;
+    std::size_t reps = 0;
+    std::size_t items = 0;
+    double minNs = 0;
+    double medianNs = 0;
+};
+
+/**
+ * @brief Runs the benchmarks and collects their results
+ */
+class Harness {
+private:
+    std::string _filter;
+    std::vector<Result> _results;
+
+public:
+    Harness(const std::string& filter)
+        : _filter(filter)
+    {
+    }
+
+    /**
+     * @brief Tells if the benchmark of the given name is selected
+     */
+    bool enabled(const std::string& name) const
+    {
+        return _filter.empty() || name.find(_filter) != std::string::npos;
+    }
+
+    /**
+     * @brief Times run() (setup() is called untimed before each repetition)
+     * @param name The name of the benchmark
+     * @param n The number of entities
+     * @param items The number of operations of a run (for the ns/item)
+     * @param setup Prepares a repetition
+     * @param run The timed part
+     */
+    template <typename S, typename R>
+    void measure(const std::string& name, const std::size_t& n, const std::size_t& items,
+        const S& setup, const R& run)
+    {
+        if (enabled(name) == false)
+            return;
+        const std::size_t reps = std::clamp<std::size_t>(2000000 / std::max<std::size_t>(n, 1), 5, 100);
+        std::vector<double> times;
+
+        times.reserve(reps);
+        for (std::size_t i = 0; i < reps; i++) {
+            setup();
+            const auto t0 = Clock::now();
+            run();
+            times.push_back(std::chrono::duration<double, std::nano>(Clock::now() - t0).count());
+        }
+        std::sort(times.begin(), times.end());
+        Result r;
+        r.name = name;
+        r.entities = n;
+        r.reps = reps;
+        r.items = items;
+        r.minNs = times.front();
+        r.medianNs = times[times.size() / 2];
+        std::cerr << name << " n=" << n << ": " << r.medianNs / 1e6 << " ms ("
+                  << r.medianNs / std::max<std::size_t>(items, 1) << " ns/item)\n";
+        _results.push_back(r);
+    }
+
+    /**
+     * @brief Writes the results as JSON
+     */
+    void write(std::ostream& os) const
+    {
+        os << "{\n  \"silva_checked\": " << SILVA_CHECKED << ",\n  \"results\": [\n";
+        for (std::size_t i = 0; i < _results.size(); i++) {
+            const Result& r = _results[i];
+            os << "    { \"name\": \"" << r.name << "\", \"entities\": " << r.entities
+               << ", \"reps\": " << r.reps << ", \"min_ns\": " << r.minNs
+               << ", \"median_ns\": " << r.medianNs << ", \"ns_per_item\": "
+               << r.medianNs / std::max<std::size_t>(r.items, 1) << " }"
+               << (i + 1 < _results.size() ? ",\n" : "\n");
+        }
+        os << "  ]\n}\n";
+    }
+};
+
+/**
+ * @brief Creates n entities with a Pos (and a Vel on every other one)
+ */
+std::unique_ptr<silva::registry> populate(const std::size_t& n, const bool& withVel)
+{
+    auto r = std::make_unique<silva::registry>();
+    const auto es = r->newEntities(n);
+
+    for (std::size_t i = 0; i < n; i++) {
+        r->emplace<Pos>(es[i], float(i), 0.f);
+        if (withVel && i % 2 == 0)
+            r->emplace<Vel>(es[i], 1.f, 1.f);
+    }
+    return r;
+}
+
+void benchEntities(Harness& h, const std::size_t& n)
+{
+    std::unique_ptr<silva::registry> r;
+    const auto fresh = [&r] { r = std::make_unique<silva::registry>(); };
+
+    h.measure("create_destroy", n, 2 * n, fresh, [&r, &n] {
+        std::vector<silva::Entity> es;
+        es.reserve(n);
+        for (std::size_t i = 0; i < n; i++)
+            es.push_back(r->newEntity());
+        for (const auto& e : es)
+            r->removeEntity(e);
+    });
+    h.measure("create_bulk", n, n, fresh, [&r, &n] { sink = r->newEntities(n).size(); });
+}
+
+void benchComponents(Harness& h, const std::size_t& n)
+{
+    std::unique_ptr<silva::registry> r;
+    std::vector<silva::Entity> es;
+
+    h.measure("emplace_remove", n, 2 * n,
+        [&] {
+            r = std::make_unique<silva::registry>();
+            es = r->newEntities(n);
+        },
+        [&] {
+            const silva::ComponentIndex pos = r->registerComponent<Pos>();
+            for (const auto& e : es)
+                r->emplace<Pos>(e, 1.f, 2.f);
+            for (const auto& e : es)
+                r->removeRaw(e, pos);
+        });
+
+    r = populate(n, true);
+    h.measure("get", n, n, [] {}, [&] {
+        double s = 0;
+        for (silva::EntityId id = 0; id < n; id++)
+            s += r->get<Pos>(silva::Entity(id), false).x;
+        sink = s;
+    });
+    h.measure("view_1", n, n, [] {}, [&] {
+        double s = 0;
+        r->view<Pos>().each([&s](Pos& p) { s += p.x; });
+        sink = s;
+    });
+    h.measure("view_2", n, n / 2, [] {}, [&] {
+        double s = 0;
+        r->view<Pos, Vel>().each([&s](Pos& p, Vel& v) { s += p.x + v.x; });
+        sink = s;
+    });
+    const silva::registry& c = *r;
+    h.measure("view_2_const", n, n / 2, [] {}, [&] {
+        double s = 0;
+        c.view<const Pos, const Vel>().each([&s](const Pos& p, const Vel& v) { s += p.x + v.x; });
+        sink = s;
+    });
+
+    r->addSystem<Pos, Vel>("move").setSystemUpdate([](const silva::Entity& e, silva::registry& reg) {
+        Pos& p = reg.get<Pos>(e, false);
+        const Vel& v = reg.get<Vel>(e, false);
+        p.x += v.x;
+        p.y += v.y;
+    });
+    h.measure("system_update", n, n / 2, [] {}, [&] { r->update(); });
+
+    silva::Snapshot s;
+    r->snapshot(s);
+    h.measure("snapshot_capture", n, n, [] {}, [&] { r->snapshot(s); });
+    h.measure("snapshot_restore", n, n, [] {}, [&] { r->restore(s); });
+}
+
+/**
+ * @brief Spatial queries in pool order before and after a Morton sort of
+ *        the pool, and the cost of the sorts themselves
+ */
+void benchMorton(Harness& h, const std::size_t& n)
+{
+    // constant density: ~5 neighbours in a radius of 12
+    const float side = std::sqrt(n / 0.0125f);
+    const std::size_t queries = std::min<std::size_t>(n, 100000);
+    const auto key = [](const Pos& p) { return silva::morton(p.x, p.y, 16.f); };
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> u(0, side);
+    silva::registry r;
+    const auto es = r.newEntities(n);
+
+    for (const auto& e : es)
+        r.emplace<Pos>(e, u(rng), u(rng));
+    r.addSpatialIndex<Pos>(16.f, [](const Pos& p) { return silva::AABB { p.x, p.y, p.x, p.y }; });
+
+    const silva::registry& c = r;
+    const auto sweep = [&c, &queries] {
+        std::vector<silva::Entity> out;
+        std::size_t i = 0;
+        double s = 0;
+        c.view<const Pos>().each([&](const Pos& p) {
+            if (i++ >= queries)
+                return;
+            c.spatial<Pos>().query_radius(p.x, p.y, 12.f, out);
+            for (const auto& e : out)
+                s += c.get<Pos>(e).x;
+        });
+        sink = s;
+    };
+    h.measure("spatial_query_unsorted", n, queries, [] {}, sweep);
+    h.measure("morton_sort_full", n, n, [&] { r.sortPool<Pos>([](const Pos& p) { return p.x; }); },
+        [&] { r.sortPool<Pos>(key); });
+    h.measure("spatial_query_sorted", n, queries, [] {}, sweep);
+    h.measure("morton_sort_step", n, 20000,
+        [&] {
+            r.view<Pos>().each([&](Pos& p) {
+                p.x += u(rng) / side;
+                p.y += u(rng) / side;
+            });
+        },
+        [&] { r.sortPool<Pos>(key, 20000); });
+}
+
+/**
+ * @brief Growth and compaction of a pool of 32 bytes components with a non
+ *        trivial move, with and without the is_relocatable opt-in
+ */
+template <typename T>
+void benchRelocation(Harness& h, const std::size_t& n, const std::string& suffix)
+{
+    std::unique_ptr<silva::registry> r;
+    std::vector<silva::Entity> es;
+    const auto fill = [&] {
+        r = std::make_unique<silva::registry>();
+        es = r->newEntities(n);
+        for (std::size_t i = 0; i < n; i++)
+            r->emplace<T>(es[i], T(r.get(), float(i)));
+    };
+
+    h.measure("pool_grow_" + suffix, n, n, fill, [&] { r->reserve<T>(4 * n); });
+    h.measure("pool_compact_" + suffix, n, n,
+        [&] {
+            fill();
+            for (std::size_t i = 0; i < n; i += 2)
+                r->removeEntity(es[i]);
+        },
+        [&] { r->compact(); });
+}
+
+std::vector<std::size_t> parseSizes(const std::string& arg)
+{
+    std::vector<std::size_t> sizes;
+    std::stringstream ss(arg);
+
+    for (std::string item; std::getline(ss, item, ',');)
+        sizes.push_back(std::stoul(item));
+    return sizes;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string filter;
+    std::string out;
+    std::vector<std::size_t> sizes { 1000, 10000, 100000, 1000000 };
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--sizes" && i + 1 < argc) {
+            sizes = parseSizes(argv[++i]);
+        } else if (arg == "--out" && i + 1 < argc) {
+            out = argv[++i];
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--filter <substring>] [--sizes 1000,10000] [--out <file>]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    Harness h(filter);
+    for (const auto& n : sizes) {
+        benchEntities(h, n);
+        benchComponents(h, n);
+        benchMorton(h, n);
+        benchRelocation<Handle>(h, n, "move");
+        benchRelocation<RelocatableHandle>(h, n, "relocatable");
+    }
+    if (out.empty()) {
+        h.write(std::cout);
+    } else {
+        std::ofstream file(out);
+        h.write(file);
+    }
+    return EXIT_SUCCESS;
+}
@@ -123,6 +123,8 @@ ImTextureID convertGLTextureHandleToImTextureID(GLuint glTextureHandle);
 GLuint convertImTextureIDToGLTextureHandle(ImTextureID textureID);
 
 void RenderDrawLists(ImDrawData* draw_data); // rendering callback function prototype
+void RenderDrawLists(ImDrawData* draw_data, ImTextureID fontTexture,
+                     const ImVec2& framebufferScale);
 
 // Default mapping is XInput gamepad mapping
 void initDefaultJoystickMapping();
@@ -740,6 +742,14 @@ void Render() {
     RenderDrawLists(ImGui::GetDrawData());
 }
 
+void RenderDrawData(sf::RenderTarget& target, ImDrawData* drawData, ImTextureID fontTexture,
+                    const ImVec2& framebufferScale) {
+    target.resetGLStates();
+    target.pushGLStates();
+    RenderDrawLists(drawData, fontTexture, framebufferScale);
+    target.popGLStates();
+}
+
 void Shutdown(const sf::Window& window) {
     bool needReplacement = (s_currWindowCtx->window->getSystemHandle() == window.getSystemHandle());
 
@@ -1141,20 +1151,26 @@ void SetupRenderState(ImDrawData* draw_data, int fb_width, int fb_height) {
 
 // Rendering callback
 void RenderDrawLists(ImDrawData* draw_data) {
-    ImGui::GetDrawData();
+    ImGuiIO& io = ImGui::GetIO();
+    RenderDrawLists(draw_data, io.Fonts->TexID, io.DisplayFramebufferScale);
+}
+
+// Same as above without the current ImGui context (e.g. for draw data copied to another thread)
+void RenderDrawLists(ImDrawData* draw_data, ImTextureID fontTexture,
+                     const ImVec2& framebufferScale) {
     if (draw_data->CmdListsCount == 0) {
         return;
     }
 
-    ImGuiIO& io = ImGui::GetIO();
-    assert(io.Fonts->TexID != (ImTextureID)NULL); // You forgot to create and set font texture
+    assert(fontTexture != (ImTextureID)NULL); // You forgot to create and set font texture
+    (void)fontTexture;
 
     // Avoid rendering when minimized, scale coordinates for retina displays (screen coordinates !=
     // framebuffer coordinates)
     int fb_width = (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
     int fb_height = (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
     if (fb_width == 0 || fb_height == 0) return;
-    draw_data->ScaleClipRects(io.DisplayFramebufferScale);
+    draw_data->ScaleClipRects(framebufferScale);
 
     // Backup GL state
     // Backup GL state
@@ -8,6 +8,7 @@
 #include <SFML/Window/Joystick.hpp>
 
 #include "imgui-SFML_export.h"
+#include "imgui.h"
 
 #if __cplusplus >= 201703L // C++17 and above
 #define IMGUI_SFML_NODISCARD [[nodiscard]]
@@ -47,6 +48,11 @@ IMGUI_SFML_API void Update(const sf::Vector2i& mousePos, const sf::Vector2f& dis
 IMGUI_SFML_API void Render(sf::RenderWindow& target);
 IMGUI_SFML_API void Render(sf::RenderTarget& target);
 IMGUI_SFML_API void Render();
+// Renders draw data captured after ImGui::Render(), e.g. a copy handed to another thread
+// which owns the target's GL context; the font texture and framebuffer scale are captured
+// along with it, so the current ImGui context is never touched
+IMGUI_SFML_API void RenderDrawData(sf::RenderTarget& target, ImDrawData* drawData,
+                                   ImTextureID fontTexture, const ImVec2& framebufferScale);
 
 IMGUI_SFML_API void Shutdown(const sf::Window& window);
 // Shuts down all ImGui contexts
@@ -1,14 +1,311 @@
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
 
+// 1 records the ENGINE_PROFILE_ZONE scopes (see engine::Profiler), 0 compiles them out
+#ifndef ENGINE_PROFILER
+#define ENGINE_PROFILER 1
+#endif
+
+#include "Silva.hpp"
 #include "imgui-SFML.h"
 #include "imgui.h"
 #include <SFML/Audio.hpp>
 #include <SFML/Graphics.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
 
 namespace engine
 {
+struct ProfileEvent
+{
+    const char *name;
+    int64_t start; // ns since the profiler started
+    int64_t end;
+    uint32_t depth;
+};
+
+// Zones of one thread, only written by that thread, the oldest are overwritten once full. Readers copy it without
+// locking and drop the slots that were overwritten while they read.
+class ProfileRing
+{
+  public:
+    static constexpr size_t Capacity = 1 << 14;
+
+  private:
+    struct Slot
+    {
+        std::atomic<const char *> name{nullptr};
+        std::atomic<int64_t> start{0};
+        std::atomic<int64_t> end{0};
+        std::atomic<uint32_t> depth{0};
+    };
+
+    std::unique_ptr<Slot[]> _slots;
+    std::atomic<uint64_t> _head{0};
+    uint64_t _begin = 0; // first zone of the current owner
+
+  public:
+    uint32_t id;
+    std::string name;
+    bool owned = false;
+    uint32_t depth = 0;
+
+    explicit ProfileRing(uint32_t id) : _slots(new Slot[Capacity]), id(id)
+    {
+    }
+
+    // Hands the ring to a new thread under a new id, the zones of the previous one are dropped
+    void reuse(uint32_t newId)
+    {
+        id = newId;
+        name.clear();
+        depth = 0;
+        _begin = _head.load(std::memory_order_relaxed);
+    }
+
+    void push(const char *name, int64_t start, int64_t end, uint32_t depth)
+    {
+        const uint64_t head = _head.load(std::memory_order_relaxed);
+        Slot &slot = _slots[head & (Capacity - 1)];
+
+        // keeps the slot writes after the previous head store, like the writer of a seqlock
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.start.store(start, std::memory_order_relaxed);
+        slot.end.store(end, std::memory_order_relaxed);
+        slot.depth.store(depth, std::memory_order_relaxed);
+        _head.store(head + 1, std::memory_order_release);
+    }
+
+    void collect(std::vector<ProfileEvent> &out) const
+    {
+        const uint64_t head = _head.load(std::memory_order_acquire);
+        const uint64_t first = std::max(_begin, head > Capacity ? head - Capacity : 0);
+        const size_t base = out.size();
+
+        for (uint64_t i = first; i < head; i++)
+        {
+            const Slot &slot = _slots[i & (Capacity - 1)];
+            out.push_back(ProfileEvent{slot.name.load(std::memory_order_relaxed),
+                                       slot.start.load(std::memory_order_relaxed),
+                                       slot.end.load(std::memory_order_relaxed),
+                                       slot.depth.load(std::memory_order_relaxed)});
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t last = _head.load(std::memory_order_relaxed);
+        // the slot being written when last was read counts as overwritten too
+        const uint64_t valid = last >= Capacity ? last - Capacity + 1 : 0;
+        if (valid > first)
+            out.erase(out.begin() + base, out.begin() + base + std::min(valid - first, head - first));
+    }
+};
+
+// Collects the ENGINE_PROFILE_ZONE scopes of every thread, see ImGui::EngineProfiler() and dumpTrace()
+class Profiler
+{
+  public:
+    struct Thread
+    {
+        uint32_t id;
+        std::string name;
+        std::vector<ProfileEvent> events;
+    };
+
+  private:
+    // Gives the ring back when its thread exits, so short lived threads reuse the rings
+    struct RingOwner
+    {
+        ProfileRing *ring = nullptr;
+
+        ~RingOwner()
+        {
+            if (ring != nullptr)
+                Profiler::instance()._release(*ring);
+        }
+    };
+
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<ProfileRing>> _rings;
+    const std::chrono::steady_clock::time_point _epoch = std::chrono::steady_clock::now();
+    std::atomic<bool> _enabled{true};
+    uint32_t _nextId = 0;
+
+    void _release(ProfileRing &ring)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ring.owned = false;
+        ring.name.clear();
+        ring.depth = 0;
+    }
+
+    static std::string _escape(const std::string &str)
+    {
+        std::string escaped;
+
+        for (const char c : str)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20)
+                escaped += c;
+        }
+        return escaped;
+    }
+
+  public:
+    static Profiler &instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    bool enabled() const
+    {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+    void setEnabled(bool enabled)
+    {
+        _enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    int64_t now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _epoch).count();
+    }
+
+    // The ring of the calling thread
+    ProfileRing &ring()
+    {
+        thread_local RingOwner owner;
+
+        if (owner.ring == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (const auto &ring : _rings)
+                if (ring->owned == false)
+                {
+                    owner.ring = ring.get();
+                    owner.ring->reuse(_nextId++);
+                    break;
+                }
+            if (owner.ring == nullptr)
+            {
+                _rings.push_back(std::make_unique<ProfileRing>(_nextId++));
+                owner.ring = _rings.back().get();
+            }
+            owner.ring->owned = true;
+        }
+        return *owner.ring;
+    }
+
+    void setThreadName(const std::string &name)
+    {
+        ProfileRing &current = ring();
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        current.name = name;
+    }
+
+    std::vector<Thread> collect() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::vector<Thread> threads;
+
+        threads.reserve(_rings.size());
+        for (const auto &ring : _rings)
+        {
+            threads.push_back(Thread{ring->id, ring->name, {}});
+            ring->collect(threads.back().events);
+        }
+        return threads;
+    }
+
+    // Writes the zones still in the rings in the Chrome trace event format (chrome://tracing, Perfetto)
+    void dumpTrace(const std::string &path) const
+    {
+        std::ofstream file(path);
+
+        if (!file)
+            throw std::runtime_error("Profiler::dumpTrace() - Cannot open " + path);
+        file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        for (const Thread &thread : collect())
+        {
+            if (thread.name.empty() == false)
+            {
+                file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.id
+                     << ",\"args\":{\"name\":\"" << _escape(thread.name) << "\"}}";
+                first = false;
+            }
+            for (const ProfileEvent &event : thread.events)
+            {
+                file << (first ? "" : ",") << "\n{\"name\":\"" << _escape(event.name)
+                     << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.id << ",\"ts\":" << event.start / 1000.0
+                     << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+                first = false;
+            }
+        }
+        file << "\n]}\n";
+    }
+};
+
+inline void dumpTrace(const std::string &path)
+{
+    Profiler::instance().dumpTrace(path);
+}
+
+// Times its scope into the ring of the calling thread, the name must outlive the profiler (a string literal)
+class ProfileZone
+{
+  private:
+    const char *_name;
+    ProfileRing *_ring = nullptr;
+    int64_t _start = 0;
+
+  public:
+    explicit ProfileZone(const char *name) : _name(name)
+    {
+        Profiler &profiler = Profiler::instance();
+
+        if (profiler.enabled())
+        {
+            _ring = &profiler.ring();
+            _ring->depth++;
+            _start = profiler.now();
+        }
+    }
+
+    ProfileZone(const ProfileZone &) = delete;
+    ProfileZone &operator=(const ProfileZone &) = delete;
+
+    ~ProfileZone()
+    {
+        if (_ring != nullptr)
+        {
+            _ring->depth--;
+            _ring->push(_name, _start, Profiler::instance().now(), _ring->depth);
+        }
+    }
+};
+
+#define ENGINE_PROFILE_CONCAT_(a, b) a##b
+#define ENGINE_PROFILE_CONCAT(a, b) ENGINE_PROFILE_CONCAT_(a, b)
+#if ENGINE_PROFILER
+#define ENGINE_PROFILE_ZONE(name) engine::ProfileZone ENGINE_PROFILE_CONCAT(_engineProfileZone, __LINE__)(name)
+#else
+#define ENGINE_PROFILE_ZONE(name) ((void)0)
+#endif
+
 template <typename T> class ResourceHolder
 {
   private:
@@ -179,6 +476,7 @@ class InputManager
   public:
     void update(sf::Event &event)
     {
+        ENGINE_PROFILE_ZONE("input");
         (void)event;
         for (int k = 0; k < sf::Keyboard::KeyCount; k++)
         {
@@ -266,6 +564,296 @@ class InputManager
     {                                                                                                                  \
     }
 
+// Time from the first input event of a frame to the display() which shows the frame
+class LatencyMeter
+{
+  public:
+    struct Stats
+    {
+        float last = 0;
+        float average = 0;
+        float max = 0;
+        size_t samples = 0;
+    };
+
+  private:
+    mutable std::mutex _mutex;
+    Stats _stats;
+
+  public:
+    void record(sf::Time latency)
+    {
+        const float ms = latency.asMicroseconds() / 1000.f;
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _stats.last = ms;
+        _stats.average = _stats.samples == 0 ? ms : _stats.average + (ms - _stats.average) * 0.05f;
+        _stats.max = std::max(_stats.max, ms);
+        _stats.samples++;
+    }
+
+    Stats stats() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _stats;
+    }
+
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stats = Stats();
+    }
+};
+
+class State;
+
+// Draw commands of one frame, recorded by the update thread and executed by the render thread.
+// Drawables are copied into the packet so the state can keep updating while the frame is drawn.
+class FramePacket
+{
+  private:
+    struct Command
+    {
+        void *object;
+        sf::RenderStates states;
+        void (*run)(void *object, sf::RenderWindow &window, const sf::RenderStates &states);
+        void (*destroy)(void *object);
+    };
+
+    std::pmr::monotonic_buffer_resource _arena;
+    std::vector<Command> _commands;
+    sf::Color _clearColor = sf::Color::Black;
+    bool _synchronous = false;
+    std::optional<sf::Time> _inputTime;
+    ImDrawData _imgui;
+    std::vector<ImDrawList *> _imguiLists;
+    ImTextureID _imguiFont = nullptr;
+    ImVec2 _imguiScale = ImVec2(1.0f, 1.0f);
+
+    template <typename T> T *_store(const T &object)
+    {
+        return new (_arena.allocate(sizeof(T), alignof(T))) T(object);
+    }
+
+    void _releaseImGui()
+    {
+        for (ImDrawList *list : _imguiLists)
+            IM_DELETE(list);
+        _imguiLists.clear();
+        _imgui.Clear();
+    }
+
+  public:
+    FramePacket() = default;
+    FramePacket(const FramePacket &) = delete;
+    FramePacket &operator=(const FramePacket &) = delete;
+
+    ~FramePacket()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        for (Command &command : _commands)
+            command.destroy(command.object);
+        _commands.clear();
+        _arena.release();
+        _releaseImGui();
+        _clearColor = sf::Color::Black;
+        _synchronous = false;
+        _inputTime.reset();
+    }
+
+    void setClearColor(const sf::Color &color)
+    {
+        _clearColor = color;
+    }
+
+    template <typename T> void draw(const T &drawable, const sf::RenderStates &states = sf::RenderStates::Default)
+    {
+        static_assert(std::is_base_of_v<sf::Drawable, T>, "FramePacket::draw() - T must be a sf::Drawable");
+        _commands.push_back(Command{
+            _store(drawable), states,
+            [](void *object, sf::RenderWindow &window, const sf::RenderStates &states)
+            { window.draw(*static_cast<const T *>(object), states); },
+            [](void *object) { static_cast<T *>(object)->~T(); }});
+    }
+
+    // Anything else to run on the render thread, f is called as f(window) and must only use what it captured
+    template <typename F> void call(const F &f)
+    {
+        _commands.push_back(Command{
+            _store(f), sf::RenderStates::Default,
+            [](void *object, sf::RenderWindow &window, const sf::RenderStates &)
+            { (*static_cast<F *>(object))(window); },
+            [](void *object) { static_cast<F *>(object)->~F(); }});
+    }
+
+    void setView(const sf::View &view)
+    {
+        call([view](sf::RenderWindow &window) { window.setView(view); });
+    }
+
+    // Draws the state with its draw(window) on the render thread, the update thread waits for the frame to be
+    // drawn before stepping again (the state shares its data with the render thread)
+    void drawState(State &state);
+
+    bool synchronous() const
+    {
+        return _synchronous;
+    }
+
+    // When the first input event reflected by this frame was polled, to measure the latency once it is displayed
+    void setInputTime(const std::optional<sf::Time> &time)
+    {
+        _inputTime = time;
+    }
+    const std::optional<sf::Time> &inputTime() const
+    {
+        return _inputTime;
+    }
+
+    size_t size() const
+    {
+        return _commands.size();
+    }
+
+    // Ends the ImGui frame and keeps a copy of its draw lists and of the io state they need, so the next
+    // frame can start while this one is drawn
+    void captureImGui()
+    {
+        ENGINE_PROFILE_ZONE("Render");
+        ImGui::Render();
+        const ImDrawData *data = ImGui::GetDrawData();
+        const ImGuiIO &io = ImGui::GetIO();
+        _releaseImGui();
+        _imgui = *data;
+        _imguiFont = io.Fonts->TexID;
+        _imguiScale = io.DisplayFramebufferScale;
+        for (int i = 0; i < data->CmdListsCount; i++)
+            _imguiLists.push_back(data->CmdLists[i]->CloneOutput());
+        _imgui.CmdLists = _imguiLists.data();
+    }
+
+    void execute(sf::RenderWindow &window)
+    {
+        {
+            ENGINE_PROFILE_ZONE("draw");
+            window.clear(_clearColor);
+            for (const Command &command : _commands)
+                command.run(command.object, window, command.states);
+        }
+        {
+            ENGINE_PROFILE_ZONE("Render");
+            if (_synchronous)
+                ImGui::SFML::Render(window);
+            else if (_imgui.Valid)
+                ImGui::SFML::RenderDrawData(window, &_imgui, _imguiFont, _imguiScale);
+        }
+        ENGINE_PROFILE_ZONE("display");
+        window.display();
+    }
+};
+
+// Owns the GL context of the window and draws the submitted packets while the update thread records the next one
+class RenderThread
+{
+  private:
+    sf::RenderWindow &_window;
+    const sf::Clock &_clock;
+    LatencyMeter &_latency;
+    FramePacket _packets[2];
+    size_t _back = 0;
+    FramePacket *_pending = nullptr;
+    bool _stop = false;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::thread _thread;
+
+    void _loop()
+    {
+        Profiler::instance().setThreadName("render");
+        if (_window.setActive(true) == false)
+            std::cerr << "RenderThread - Failed to activate the window on the render thread" << std::endl;
+        for (;;)
+        {
+            FramePacket *packet = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cv.wait(lock, [this] { return _pending != nullptr || _stop; });
+                if (_pending == nullptr)
+                    break;
+                packet = _pending;
+            }
+            {
+                ENGINE_PROFILE_ZONE("render");
+                packet->execute(_window);
+            }
+            if (packet->inputTime())
+                _latency.record(_clock.getElapsedTime() - *packet->inputTime());
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _pending = nullptr;
+            }
+            _cv.notify_all();
+        }
+        _window.setActive(false);
+    }
+
+    void _wait()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [this] { return _pending == nullptr; });
+    }
+
+  public:
+    RenderThread(sf::RenderWindow &window, const sf::Clock &clock, LatencyMeter &latency)
+        : _window(window), _clock(clock), _latency(latency)
+    {
+        if (_window.setActive(false) == false)
+            throw std::runtime_error("RenderThread - Failed to release the window context");
+        _thread = std::thread(&RenderThread::_loop, this);
+    }
+
+    RenderThread(const RenderThread &) = delete;
+    RenderThread &operator=(const RenderThread &) = delete;
+
+    ~RenderThread()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _cv.notify_all();
+        _thread.join();
+        _window.setActive(true);
+    }
+
+    // The packet being recorded
+    FramePacket &packet()
+    {
+        return _packets[_back];
+    }
+
+    // Hands the recorded packet to the render thread, once it is done with the previous one
+    void submit()
+    {
+        const bool synchronous = _packets[_back].synchronous();
+
+        _wait();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pending = &_packets[_back];
+        }
+        _cv.notify_all();
+        _back ^= 1;
+        _packets[_back].reset();
+        if (synchronous)
+            _wait();
+    }
+};
+
 class State
 {
   public:
@@ -273,10 +861,22 @@ class State
     virtual void handleInput(sf::Event &event) = 0;
     virtual void update() = 0;
     virtual void draw(sf::RenderWindow &window) = 0;
+    // With the render thread, records the frame instead of draw(window), states that copy what they draw into the
+    // packet override it to keep updating while their frame is drawn
+    virtual void record(FramePacket &packet)
+    {
+        packet.drawState(*this);
+    }
     virtual void stop() = 0;
     virtual ~State() = default;
 };
 
+inline void FramePacket::drawState(State &state)
+{
+    _synchronous = true;
+    call([&state](sf::RenderWindow &window) { state.draw(window); });
+}
+
 class StateMachine
 {
   private:
@@ -335,7 +935,18 @@ class StateMachine
 
     void draw(sf::RenderWindow &window)
     {
+        ENGINE_PROFILE_ZONE("draw");
         _states.at(_currentState)->draw(window);
+        if (_pendingState != _currentState && _enableFade)
+            window.draw(_fade);
+    }
+
+    void record(FramePacket &packet)
+    {
+        ENGINE_PROFILE_ZONE("draw");
+        _states.at(_currentState)->record(packet);
+        if (_pendingState != _currentState && _enableFade)
+            packet.draw(_fade);
     }
 
     void start()
@@ -366,6 +977,71 @@ class Game
     static inline InputManager *_inputManager = nullptr;
     static inline bool _builded = false;
     static inline Game *_game = nullptr;
+    static inline double _tickRate = 60;
+    static inline unsigned int _maxStepsPerFrame = 5;
+    static inline unsigned int _framerateLimit = 60;
+    static inline bool _verticalSync = false;
+    static inline float _alpha = 0;
+    static inline bool _renderThread = false;
+    static inline bool _lowLatency = false;
+    static inline bool _lateInputSampling = false;
+    static inline sf::Clock _clock;
+    static inline LatencyMeter _latency;
+    static inline std::optional<sf::Time> _inputTime;
+
+    static bool _isInputEvent(const sf::Event &event)
+    {
+        switch (event.type)
+        {
+        case sf::Event::TextEntered:
+        case sf::Event::KeyPressed:
+        case sf::Event::KeyReleased:
+        case sf::Event::MouseWheelScrolled:
+        case sf::Event::MouseButtonPressed:
+        case sf::Event::MouseButtonReleased:
+        case sf::Event::MouseMoved:
+        case sf::Event::JoystickButtonPressed:
+        case sf::Event::JoystickButtonReleased:
+        case sf::Event::JoystickMoved:
+        case sf::Event::TouchBegan:
+        case sf::Event::TouchMoved:
+        case sf::Event::TouchEnded:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static void _pollEvents()
+    {
+        ENGINE_PROFILE_ZONE("events");
+        while (_window->pollEvent(*_event))
+        {
+            if (_inputTime.has_value() == false && _isInputEvent(*_event))
+                _inputTime = _clock.getElapsedTime();
+            ImGui::SFML::ProcessEvent(*_event);
+            if (_event->type == sf::Event::Closed)
+            {
+                _stateMachine->changeState(-1, 0);
+                return;
+            }
+            _stateMachine->handleInput(*_event);
+        }
+    }
+
+    static void _renderImGui()
+    {
+        ENGINE_PROFILE_ZONE("Render");
+        ImGui::SFML::Render(*_window);
+    }
+
+    static void _display(const std::optional<sf::Time> &inputTime)
+    {
+        ENGINE_PROFILE_ZONE("display");
+        _window->display();
+        if (inputTime)
+            _latency.record(_clock.getElapsedTime() - *inputTime);
+    }
 
   public:
     static sf::RenderWindow &window()
@@ -393,6 +1069,72 @@ class Game
         return _game;
     }
 
+    static double deltaTime()
+    {
+        return 1.0 / _tickRate;
+    }
+    // How far the current frame is between the last step and the next one (0 to 1), to interpolate in draw
+    static float alpha()
+    {
+        return _alpha;
+    }
+    static void setTickRate(double ticksPerSecond)
+    {
+        if (ticksPerSecond <= 0)
+            throw std::runtime_error("Game::setTickRate() - The tick rate must be positive");
+        _tickRate = ticksPerSecond;
+    }
+    // Steps run at most per frame, the rest of the late time is dropped (avoids the spiral of death)
+    static void setMaxStepsPerFrame(unsigned int steps)
+    {
+        _maxStepsPerFrame = std::max(steps, 1u);
+    }
+    static void setFramerateLimit(unsigned int limit)
+    {
+        _framerateLimit = limit;
+        if (_window != nullptr && _window->isOpen())
+            _window->setFramerateLimit(limit);
+    }
+    static void setVerticalSync(bool enabled)
+    {
+        _verticalSync = enabled;
+        if (_window != nullptr && _window->isOpen())
+            _window->setVerticalSyncEnabled(enabled);
+    }
+
+    // Draws on a dedicated thread while the next frame updates, states record their frame with State::record()
+    static void setRenderThread(bool enabled)
+    {
+        if (_window != nullptr && _window->isOpen())
+            throw std::runtime_error("Game::setRenderThread() - Must be called before Game::run()");
+        _renderThread = enabled;
+    }
+    static bool renderThread()
+    {
+        return _renderThread;
+    }
+
+    // Draws and displays each frame right after its update instead of displaying it on the next iteration
+    static void setLowLatency(bool enabled)
+    {
+        _lowLatency = enabled;
+    }
+    // Polls the events again just before drawing, they go to handleInput() but the key states only change on the
+    // next step
+    static void setLateInputSampling(bool enabled)
+    {
+        _lateInputSampling = enabled;
+    }
+    // Time from the first input event polled for a frame to the display() of that frame
+    static LatencyMeter::Stats inputLatency()
+    {
+        return _latency.stats();
+    }
+    static void resetInputLatency()
+    {
+        _latency.reset();
+    }
+
     static void construct()
     {
         if (_game == nullptr)
@@ -430,41 +1172,79 @@ class Game
 
     void run()
     {
-        sf::Clock imGuiClockDeltaTime;
+        sf::Clock frameClock;
+        double accumulator = 0;
+        bool running = true;
+        std::optional<sf::Time> drawnInputTime;
+        std::unique_ptr<RenderThread> renderThread;
 
         if (!_builded)
             throw std::runtime_error("Game is not constructed");
         _window->create(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "Game", sf::Style::Close);
-        _window->setFramerateLimit(60);
+        _window->setFramerateLimit(_framerateLimit);
+        _window->setVerticalSyncEnabled(_verticalSync);
         _stateMachine->start();
-        while (_window->isOpen())
+        if (_renderThread)
+            renderThread = std::make_unique<RenderThread>(*_window, _clock, _latency);
+        Profiler::instance().setThreadName("main");
+        while (running && _window->isOpen())
         {
-            while (_window->pollEvent(*_event))
+            ENGINE_PROFILE_ZONE("frame");
+            _pollEvents();
+            const sf::Time frameTime = frameClock.restart();
+            const double step = deltaTime();
+            unsigned int steps = 0;
+
+            {
+                ENGINE_PROFILE_ZONE("ImGui::SFML::Update");
+                ImGui::SFML::Update(*_window, frameTime);
+            }
+            accumulator += frameTime.asSeconds();
+            for (; accumulator >= step && steps < _maxStepsPerFrame; steps++)
             {
                 _inputManager->update(*_event);
-                ImGui::SFML::ProcessEvent(*_event);
-                if (_event->type == sf::Event::Closed)
-                {
-                    _stateMachine->changeState(-1, 0);
+                running = _stateMachine->update();
+                if (running == false)
                     break;
-                }
-                else
-                {
-                    _stateMachine->handleInput(*_event);
-                }
+                accumulator -= step;
             }
-            _inputManager->update(*_event);
-            ImGui::SFML::Update(*_window, imGuiClockDeltaTime.restart());
-            if (_stateMachine->update() == false)
+            if (running == false)
+                break;
+            if (accumulator >= step)
+                accumulator = std::fmod(accumulator, step);
+            _alpha = static_cast<float>(accumulator / step);
+            if (_lateInputSampling)
+                _pollEvents();
+            const std::optional<sf::Time> inputTime = _inputTime;
+            _inputTime.reset();
+            if (renderThread)
             {
-                _window->close();
-                return;
+                FramePacket &packet = renderThread->packet();
+
+                _stateMachine->record(packet);
+                if (packet.synchronous() == false)
+                    packet.captureImGui();
+                packet.setInputTime(inputTime);
+                renderThread->submit();
+            }
+            else if (_lowLatency)
+            {
+                _window->clear();
+                _stateMachine->draw(*_window);
+                _renderImGui();
+                _display(inputTime);
+            }
+            else
+            {
+                _display(drawnInputTime);
+                _window->clear();
+                _stateMachine->draw(*_window);
+                _renderImGui();
+                drawnInputTime = inputTime;
             }
-            _window->display();
-            _window->clear();
-            _stateMachine->draw(*_window);
-            ImGui::SFML::Render(*_window);
         }
+        renderThread.reset();
+        _window->close();
     }
 
     void addState(State *state)
@@ -507,19 +1287,18 @@ class Game
 
 inline bool StateMachine::update()
 {
+    ENGINE_PROFILE_ZONE("StateMachine::update");
     if (_pendingState != _currentState)
     {
         double percent = ((double)_clock.getElapsedTime().asMilliseconds() - _startTime) / _transitionTime;
         if (_enableFade)
         {
-            const double alpha = (float)255 * percent;
+            const double alpha = (float)255 * std::min(percent, 1.0);
             _fade.setFillColor(sf::Color(0, 0, 0, alpha));
             _fade.setSize(sf::Vector2f(WINDOW_WIDTH, WINDOW_HEIGHT));
-            Game::window().draw(_fade);
         }
         if (_startTime + _transitionTime < _clock.getElapsedTime().asMilliseconds())
         {
-            Game::window().clear();
             _states.at(_currentState)->stop();
             _states.at(_pendingState)->init();
             _currentState = _pendingState;
@@ -544,6 +1323,33 @@ inline sf::Vector2i InputManager::getMousePosPixel(const sf::View &view = Game::
     return Game::window().mapCoordsToPixel(vto<float, int>(getMousePos()), view);
 }
 
+struct Transform
+{
+    sf::Transformable local;
+    sf::Transform world;
+};
+
+inline sf::Transformable &editTransform(silva::registry &r, const silva::Entity &e)
+{
+    sf::Transformable &local = r.get<Transform>(e, false).local;
+    r.hierarchy().add(e).markDirty(e);
+    return local;
+}
+
+inline void propagateTransforms(silva::registry &r)
+{
+    r.hierarchy().propagate([&r](const silva::Entity &e, const silva::Entity &parent)
+    {
+        if (r.has<Transform>(e, false) == false)
+            return;
+        Transform &t = r.get<Transform>(e, false);
+        if (parent.id == silva::InvalidEntityId || r.has<Transform>(parent, false) == false)
+            t.world = t.local.getTransform();
+        else
+            t.world = sf::Transform(r.get<Transform>(parent, false).world).combine(t.local.getTransform());
+    });
+}
+
 }; // namespace engine
 
 namespace ImGui {
@@ -598,4 +1404,219 @@ namespace ImGui {
         ImGui::EndMenu();
     }
 
+    static inline void EngineLatency(bool* open = nullptr)
+    {
+        const engine::LatencyMeter::Stats stats = engine::Game::inputLatency();
+        ImGui::BeginLock lock("Input latency", open);
+
+        ImGui::Text("Last: %.2f ms", stats.last);
+        ImGui::Text("Average: %.2f ms", stats.average);
+        ImGui::Text("Max: %.2f ms", stats.max);
+        ImGui::Text("Samples: %zu", stats.samples);
+        if (ImGui::Button("Reset"))
+            engine::Game::resetInputLatency();
+    }
+
+    // Flame graph of the last frame of the main thread, with what the other threads did meanwhile
+    static inline void EngineProfiler(bool* open = nullptr)
+    {
+        static bool paused = false;
+        static std::vector<engine::Profiler::Thread> threads;
+        ImGui::BeginLock lock("Profiler", open);
+
+        ImGui::Checkbox("Pause", &paused);
+        ImGui::SameLine();
+        if (ImGui::Button("Dump trace"))
+            engine::dumpTrace("trace.json");
+        if (paused == false || threads.empty())
+            threads = engine::Profiler::instance().collect();
+
+        const engine::ProfileEvent* frame = nullptr;
+        for (const auto& thread : threads) {
+            for (const auto& event : thread.events) {
+                if (event.depth == 0 && std::strcmp(event.name, "frame") == 0 && (frame == nullptr || event.start > frame->start))
+                    frame = &event;
+            }
+        }
+        if (frame == nullptr) {
+            ImGui::TextUnformatted("No frame recorded");
+            return;
+        }
+
+        const float width = std::max(ImGui::GetContentRegionAvail().x, 1.f);
+        const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+        const double scale = width / static_cast<double>(std::max<int64_t>(frame->end - frame->start, 1));
+        ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+        ImGui::Text("Frame: %.3f ms", (frame->end - frame->start) / 1e6);
+        for (const auto& thread : threads) {
+            uint32_t rows = 0;
+            for (const auto& event : thread.events) {
+                if (event.end > frame->start && event.start < frame->end)
+                    rows = std::max(rows, event.depth + 1);
+            }
+            if (rows == 0)
+                continue;
+            ImGui::TextUnformatted(thread.name.empty() ? "thread" : thread.name.c_str());
+            const ImVec2 origin = ImGui::GetCursorScreenPos();
+            ImGui::Dummy(ImVec2(width, rowHeight * rows));
+            for (const auto& event : thread.events) {
+                if (event.end <= frame->start || event.start >= frame->end)
+                    continue;
+                const ImVec2 min(origin.x + static_cast<float>((std::max(event.start, frame->start) - frame->start) * scale),
+                    origin.y + rowHeight * event.depth);
+                const ImVec2 max(std::max(origin.x + static_cast<float>((std::min(event.end, frame->end) - frame->start) * scale), min.x + 1.f),
+                    min.y + rowHeight - 1.f);
+                const float hue = static_cast<float>(std::hash<std::string_view>()(event.name) % 360) / 360.f;
+
+                drawList->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.7f));
+                drawList->PushClipRect(min, max, true);
+                drawList->AddText(ImVec2(min.x + 2.f, min.y), IM_COL32_WHITE, event.name);
+                drawList->PopClipRect();
+                if (ImGui::IsMouseHoveringRect(min, max))
+                    ImGui::SetTooltip("%s: %.3f ms", event.name, (event.end - event.start) / 1e6);
+            }
+        }
+    }
+
+    static inline void SilvaStats(const silva::registry& r, bool* open = nullptr)
+    {
+        const silva::RegistryStats stats = r.stats();
+        ImGui::BeginLock lock("Silva", open);
+
+        ImGui::Text("Entities: %zu", stats.entities);
+        if (ImGui::BeginTable("pools", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("Component");
+            ImGui::TableSetupColumn("Count");
+            ImGui::TableSetupColumn("Capacity");
+            ImGui::TableSetupColumn("Used (B)");
+            ImGui::TableSetupColumn("Reserved (B)");
+            ImGui::TableSetupColumn("Sparse fill");
+            ImGui::TableHeadersRow();
+            for (const auto& pool : stats.pools) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(pool.name.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%zu", pool.count);
+                ImGui::TableNextColumn();
+                ImGui::Text("%zu", pool.capacity);
+                ImGui::TableNextColumn();
+                ImGui::Text("%zu", pool.bytesUsed);
+                ImGui::TableNextColumn();
+                ImGui::Text("%zu", pool.bytesReserved);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f%%", pool.sparseFill * 100.0);
+            }
+            ImGui::EndTable();
+        }
+        if (ImGui::BeginTable("systems", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("System");
+            ImGui::TableSetupColumn("Entities");
+            ImGui::TableSetupColumn("Last update (us)");
+            ImGui::TableHeadersRow();
+            for (const auto& sys : stats.systems) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(sys.tag.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%zu", sys.entities);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", sys.lastUpdate.count() / 1000.0);
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    static inline void SilvaSystems(const silva::registry& r, float budgetMs = 16.6f, bool* open = nullptr)
+    {
+        const std::vector<silva::SystemStats> systems = r.systemStats();
+        double totalMs = 0;
+        std::size_t worst = 0;
+        for (std::size_t i = 0; i < systems.size(); i++) {
+            totalMs += systems[i].lastUpdate.count() / 1e6;
+            if (systems[i].lastUpdate > systems[worst].lastUpdate)
+                worst = i;
+        }
+        const bool over = totalMs > budgetMs;
+        ImGui::BeginLock lock("Silva systems", open,
+            ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_AlwaysAutoResize);
+
+        ImGui::Text("Systems: %.3f / %.1f ms", totalMs, budgetMs);
+        if (ImGui::BeginTable("systems", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("Stage");
+            ImGui::TableSetupColumn("System");
+            ImGui::TableSetupColumn("Updated");
+            ImGui::TableSetupColumn("Time (us)");
+            ImGui::TableSetupColumn("Budget");
+            ImGui::TableHeadersRow();
+            for (std::size_t i = 0; i < systems.size(); i++) {
+                const silva::SystemStats& sys = systems[i];
+                const double ms = sys.lastUpdate.count() / 1e6;
+                const bool culprit = over && i == worst;
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(silva::stageName(sys.stage));
+                ImGui::TableNextColumn();
+                if (culprit)
+                    ImGui::TextColored(ImVec4(1.f, 0.3f, 0.3f, 1.f), "%s", sys.tag.c_str());
+                else
+                    ImGui::TextUnformatted(sys.tag.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%zu / %zu", sys.updated, sys.entities);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", ms * 1000.0);
+                ImGui::TableNextColumn();
+                ImGui::ProgressBar(budgetMs > 0 ? static_cast<float>(ms / budgetMs) : 0.f, ImVec2(80.f, 0.f));
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    static inline void SilvaAccess(const silva::registry& r, float maxGetsPerEntity = 2.f, bool* open = nullptr)
+    {
+        std::vector<silva::AccessStats> calls = r.accessStats();
+        std::sort(calls.begin(), calls.end(),
+            [](const silva::AccessStats& a, const silva::AccessStats& b) { return a.get > b.get; });
+        ImGui::BeginLock lock("Silva access", open,
+            ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_AlwaysAutoResize);
+
+        if (SILVA_COUNTERS == 0) {
+            ImGui::TextUnformatted("Build with SILVA_COUNTERS=1 to count the accesses");
+            return;
+        }
+        if (ImGui::BeginTable("access", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("System");
+            ImGui::TableSetupColumn("Component");
+            ImGui::TableSetupColumn("get");
+            ImGui::TableSetupColumn("has");
+            ImGui::TableSetupColumn("emplace");
+            ImGui::TableSetupColumn("views");
+            ImGui::TableSetupColumn("get / entity");
+            ImGui::TableHeadersRow();
+            for (const auto& call : calls) {
+                const double perEntity = call.entities ? static_cast<double>(call.get) / call.entities : 0;
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(call.system.empty() ? "-" : call.system.c_str());
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(call.component.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%zu", call.get);
+                ImGui::TableNextColumn();
+                ImGui::Text("%zu", call.has);
+                ImGui::TableNextColumn();
+                ImGui::Text("%zu", call.emplace);
+                ImGui::TableNextColumn();
+                ImGui::Text("%zu", call.views);
+                ImGui::TableNextColumn();
+                if (perEntity > maxGetsPerEntity)
+                    ImGui::TextColored(ImVec4(1.f, 0.3f, 0.3f, 1.f), "%.1f", perEntity);
+                else
+                    ImGui::Text("%.1f", perEntity);
+            }
+            ImGui::EndTable();
+        }
+    }
+
 }
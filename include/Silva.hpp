@@ -20,16 +20,43 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <any>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <exception>
+#include <fstream>
 #include <functional>
+#include <istream>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <memory_resource>
+#include <new>
 #include <ostream>
-#include <stack>
+#include <queue>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace silva {
 
 /**
@@ -59,6 +86,35 @@ public:
     inline virtual const char* what() const noexcept override { return _msg.c_str(); }
 };
 
+/**
+ * @brief Checked mode: 1 validates every access and throws a silva::Error
+ *        with the full context on misuse, 0 turns the accessors into plain
+ *        indexed loads (misuse is then undefined behaviour)
+ *        Defaults to checked unless NDEBUG is defined
+ */
+#ifndef SILVA_CHECKED
+#ifdef NDEBUG
+#define SILVA_CHECKED 0
+#else
+#define SILVA_CHECKED 1
+#endif
+#endif
+
+/**
+ * @brief Access counters: 1 makes the registry count the calls to get, has,
+ *        emplace and view per component type and per system for each frame
+ *        (see registry::accessStats), 0 compiles the counting out
+ */
+#ifndef SILVA_COUNTERS
+#define SILVA_COUNTERS 0
+#endif
+
+#if SILVA_COUNTERS
+#define SILVA_COUNT(component, field) _count(component, &priv::AccessCounts::field)
+#else
+#define SILVA_COUNT(component, field) ((void)0)
+#endif
+
 namespace priv {
 
 /**
@@ -85,6 +141,44 @@ namespace priv {
          */
         std::vector<std::unique_ptr<T>> _registry;
 
+        /**
+         * @brief Get the slot at the given index
+         *        (bounds checked in checked mode only)
+         * @param i The index of the slot
+         * @param caller The name of the calling function (for the error)
+         * @return std::unique_ptr<T>& The slot
+         */
+        inline std::unique_ptr<T>& _slot(const std::size_t& i, const char* caller)
+        {
+#if SILVA_CHECKED
+            if (i >= _registry.size())
+                throw Error(std::string(caller) + "(" + std::to_string(i)
+                    + "): index out of range (size " + std::to_string(_registry.size()) + ")");
+#else
+            (void)caller;
+#endif
+            return _registry[i];
+        }
+
+        /**
+         * @brief Get the slot at the given index
+         *        (bounds checked in checked mode only)
+         * @param i The index of the slot
+         * @param caller The name of the calling function (for the error)
+         * @return const std::unique_ptr<T>& The slot
+         */
+        inline const std::unique_ptr<T>& _slot(const std::size_t& i, const char* caller) const
+        {
+#if SILVA_CHECKED
+            if (i >= _registry.size())
+                throw Error(std::string(caller) + "(" + std::to_string(i)
+                    + "): index out of range (size " + std::to_string(_registry.size()) + ")");
+#else
+            (void)caller;
+#endif
+            return _registry[i];
+        }
+
     public:
         /**
          * @brief Construct a new Sparse Array
@@ -137,13 +231,7 @@ namespace priv {
          */
         inline void set(std::unique_ptr<T>&& elem, const std::size_t& i)
         {
-            try {
-                _registry.at(i) = std::move(elem);
-            } catch (const std::exception& e) {
-                throw Error(std::string("set(0x")
-                    + std::to_string(static_cast<size_t>(elem.get())) + ", "
-                    + std::to_string(i) + "): " + e.what());
-            }
+            _slot(i, "set") = std::move(elem);
         }
 
         /**
@@ -153,13 +241,7 @@ namespace priv {
          */
         inline void set(std::unique_ptr<T>& elem, const std::size_t& i)
         {
-            try {
-                _registry.at(i) = std::move(elem);
-            } catch (const std::exception& e) {
-                throw Error(std::string("set(0x")
-                    + std::to_string(static_cast<size_t>(elem.get())) + ", "
-                    + std::to_string(i) + "): " + e.what());
-            }
+            _slot(i, "set") = std::move(elem);
         }
 
         /**
@@ -169,13 +251,7 @@ namespace priv {
          */
         inline void set(T* elem, const std::size_t& i)
         {
-            try {
-                _registry.at(i) = std::unique_ptr<T>(elem);
-            } catch (const std::exception& e) {
-                throw Error(std::string("set(0x")
-                    + std::to_string(reinterpret_cast<size_t>(elem)) + ", "
-                    + std::to_string(i) + "): " + e.what());
-            }
+            _slot(i, "set") = std::unique_ptr<T>(elem);
         }
 
         /**
@@ -185,13 +261,7 @@ namespace priv {
          */
         inline void set(const T& elem, const std::size_t& i)
         {
-            try {
-                _registry.at(i) = std::make_unique<T>(elem);
-            } catch (const std::exception& e) {
-                throw Error(std::string("set(")
-                    + std::to_string(static_cast<size_t>(&elem)) + ", "
-                    + std::to_string(i) + "): " + e.what());
-            }
+            _slot(i, "set") = std::make_unique<T>(elem);
         }
 
         /**
@@ -201,12 +271,7 @@ namespace priv {
          */
         inline void set(const std::size_t& i)
         {
-            try {
-                _registry.at(i) = std::make_unique<T>();
-            } catch (const std::exception& e) {
-                throw Error(
-                    std::string("set(") + std::to_string(i) + "): " + e.what());
-            }
+            _slot(i, "set") = std::make_unique<T>();
         }
 
         /**
@@ -216,12 +281,7 @@ namespace priv {
          */
         inline void unset(const std::size_t& i)
         {
-            try {
-                _registry.at(i) = std::unique_ptr<T>(nullptr);
-            } catch (std::exception& e) {
-                throw Error(std::string("unset(") + std::to_string(i)
-                    + "): " + e.what());
-            }
+            _slot(i, "unset") = std::unique_ptr<T>(nullptr);
         }
 
         /**
@@ -231,10 +291,12 @@ namespace priv {
          */
         inline T& get(const std::size_t& i)
         {
-            if (isSet(i))
-                return *_registry.at(i);
-            throw Error("Trying to get a value at an unset index: "
-                + std::to_string(i));
+#if SILVA_CHECKED
+            if (isSet(i) == false)
+                throw Error("Trying to get a value at an unset index: "
+                    + std::to_string(i));
+#endif
+            return *_registry[i];
         }
 
         /**
@@ -244,42 +306,39 @@ namespace priv {
          */
         inline const T& cget(const std::size_t& i) const
         {
-            if (isSet(i))
-                return *_registry.at(i);
-            throw Error("Trying to get a value at an unset index: "
-                + std::to_string(i));
+#if SILVA_CHECKED
+            if (isSet(i) == false)
+                throw Error("Trying to get a value at an unset index: "
+                    + std::to_string(i));
+#endif
+            return *_registry[i];
         }
 
         /**
          * @brief Get the value at the given index
          * @param i The index to get the value at
-         * @return std::unique_ptr<T>& The object value container at the given
-         * index
+         * @return T* The value at the given index (nullptr if unset or out
+         *         of range, never throws)
          */
-        inline std::unique_ptr<T>& getO(const std::size_t& i)
+        inline T* try_get(const std::size_t& i)
         {
-            try {
-                return _registry.at(i);
-            } catch (std::exception& e) {
-                throw Error(std::string("getO(") + std::to_string(i)
-                    + "): " + e.what());
-            }
+            return i < _registry.size() ? _registry[i].get() : nullptr;
         }
 
+        /**
+         * @brief Get the value at the given index
+         * @param i The index to get the value at
+         * @return std::unique_ptr<T>& The object value container at the given
+         * index
+         */
+        inline std::unique_ptr<T>& getO(const std::size_t& i) { return _slot(i, "getO"); }
+
         /**
          * @brief Get the value at the given index
          * @param i The index to get the value at
          * @return T* The value at the given index
          */
-        inline bool isSet(const std::size_t& i) const
-        {
-            try {
-                return _registry.at(i) != nullptr;
-            } catch (std::exception& e) {
-                throw Error(std::string("isSet(") + std::to_string(i)
-                    + "): " + e.what());
-            }
-        }
+        inline bool isSet(const std::size_t& i) const { return _slot(i, "isSet") != nullptr; }
 
         /**
          * @brief Get the size of the SparseArray
@@ -554,6 +613,273 @@ namespace priv {
          */
         inline Iterator end() { return Iterator(*this, _registry.size()); }
     };
+
+    /**
+     * @brief An atomic that can be moved (the value is copied, the moved
+     *        from atomic must not be in use by other threads)
+     * @tparam T Type of the value
+     */
+    template <typename T>
+    struct MovableAtomic : std::atomic<T> {
+        using std::atomic<T>::atomic;
+        using std::atomic<T>::operator=;
+
+        inline MovableAtomic(MovableAtomic&& other) noexcept
+            : std::atomic<T>(other.load(std::memory_order_relaxed))
+        {
+        }
+
+        inline MovableAtomic& operator=(MovableAtomic&& other) noexcept
+        {
+            this->store(other.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+    };
+
+/**
+ * @brief Number of slots held by a single page of a PagedArray
+ *        (must be a power of two)
+ */
+#ifndef SILVA_PAGE_SIZE
+#define SILVA_PAGE_SIZE 4096
+#endif
+
+    /**
+     * @brief A PagedArray is a sparse index split in fixed size pages
+     *        Pages are only allocated when a slot inside of them is written
+     *        so growing never moves the already stored values and
+     *        high indexes do not commit memory for the unused range
+     *        Unset slots are value-initialized (nullptr, 0, ...)
+     *        Pages are taken from the given memory resource
+     * @tparam T Type of the slots
+     * @tparam PageSize Number of slots per page
+     */
+    template <typename T, std::size_t PageSize = SILVA_PAGE_SIZE>
+    class PagedArray {
+        static_assert(PageSize != 0 && (PageSize & (PageSize - 1)) == 0,
+            "PagedArray: PageSize must be a power of two");
+
+    public:
+        /**
+         * @brief A page of the array
+         */
+        using Page = std::array<T, PageSize>;
+
+    private:
+        /**
+         * @brief The resource the pages are allocated from
+         */
+        std::pmr::memory_resource* _resource;
+
+        /**
+         * @brief The page table (only pointers are moved when it grows)
+         */
+        std::pmr::vector<Page*> _pages;
+
+        /**
+         * @brief The number of allocated pages
+         */
+        std::size_t _committed = 0;
+
+        /**
+         * @brief Get the page holding the given index
+         * @param i The index
+         * @return std::size_t The page number
+         */
+        static inline std::size_t _page(const std::size_t& i) { return i / PageSize; }
+
+        /**
+         * @brief Get the offset of the given index inside of its page
+         * @param i The index
+         * @return std::size_t The offset inside the page
+         */
+        static inline std::size_t _offset(const std::size_t& i) { return i & (PageSize - 1); }
+
+        /**
+         * @brief Allocate a new page from the resource
+         * @return Page* The new page
+         */
+        inline Page* _allocate()
+        {
+            std::pmr::polymorphic_allocator<Page> alloc(_resource);
+            Page* page = alloc.allocate(1);
+            try {
+                new (page) Page();
+            } catch (...) {
+                alloc.deallocate(page, 1);
+                throw;
+            }
+            return page;
+        }
+
+        /**
+         * @brief Give a page back to the resource
+         * @param page The page to release
+         */
+        inline void _release(Page* page)
+        {
+            std::pmr::polymorphic_allocator<Page> alloc(_resource);
+            page->~Page();
+            alloc.deallocate(page, 1);
+        }
+
+    public:
+        /**
+         * @brief Construct a new empty PagedArray (no page is allocated)
+         * @param resource The resource the pages are allocated from
+         */
+        inline PagedArray(
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : _resource(resource)
+            , _pages(resource)
+        {
+        }
+
+        PagedArray(const PagedArray&) = delete;
+        PagedArray& operator=(const PagedArray&) = delete;
+
+        /**
+         * @brief Move construct a PagedArray, the pages are taken over
+         *        (other is left empty)
+         * @param other The array to move from
+         */
+        inline PagedArray(PagedArray&& other) noexcept
+            : _resource(other._resource)
+            , _pages(std::move(other._pages))
+            , _committed(std::exchange(other._committed, 0))
+        {
+            other._pages.clear();
+        }
+
+        /**
+         * @brief Release the pages and take over the ones of other
+         *        (along with its resource, other is left empty)
+         * @param other The array to move from
+         * @return PagedArray& This array
+         */
+        inline PagedArray& operator=(PagedArray&& other)
+        {
+            if (this != &other) {
+                clear();
+                _resource = other._resource;
+                _pages.assign(other._pages.begin(), other._pages.end());
+                _committed = std::exchange(other._committed, 0);
+                other._pages.clear();
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Destroy the PagedArray and release all its pages
+         */
+        inline ~PagedArray() { clear(); }
+
+        /**
+         * @brief Tells if the page holding the given index is allocated
+         * @param i The index to check
+         * @return true The page is allocated
+         * @return false The page is not allocated
+         */
+        inline bool committed(const std::size_t& i) const
+        {
+            const std::size_t p = _page(i);
+            return p < _pages.size() && _pages[p] != nullptr;
+        }
+
+        /**
+         * @brief Get the slot at the given index, allocating its page if needed
+         * @param i The index of the slot
+         * @return T& The slot
+         */
+        inline T& at(const std::size_t& i)
+        {
+            const std::size_t p = _page(i);
+            try {
+                if (p >= _pages.size())
+                    _pages.resize(p + 1, nullptr);
+                if (_pages[p] == nullptr) {
+                    _pages[p] = _allocate();
+                    _committed++;
+                }
+            } catch (const std::exception& e) {
+                throw Error(std::string("PagedArray::at(") + std::to_string(i)
+                    + "): " + e.what());
+            }
+            return (*_pages[p])[_offset(i)];
+        }
+
+        /**
+         * @brief Find the slot at the given index without allocating anything
+         * @param i The index of the slot
+         * @return T* The slot or nullptr if its page is not allocated
+         */
+        inline T* find(const std::size_t& i)
+        {
+            return committed(i) ? &(*_pages[_page(i)])[_offset(i)] : nullptr;
+        }
+
+        /**
+         * @brief Find the slot at the given index without allocating anything
+         * @param i The index of the slot
+         * @return const T* The slot or nullptr if its page is not allocated
+         */
+        inline const T* find(const std::size_t& i) const
+        {
+            return committed(i) ? &(*_pages[_page(i)])[_offset(i)] : nullptr;
+        }
+
+        /**
+         * @brief Get the slot at the given index without any check
+         *        (its page must be allocated)
+         * @param i The index of the slot
+         * @return const T& The slot
+         */
+        inline const T& operator[](const std::size_t& i) const
+        {
+            return (*_pages[_page(i)])[_offset(i)];
+        }
+
+        /**
+         * @brief Reset the slot at the given index to its unset value
+         *        (does nothing if the page is not allocated)
+         * @param i The index of the slot
+         */
+        inline void reset(const std::size_t& i)
+        {
+            if (committed(i))
+                (*_pages[_page(i)])[_offset(i)] = T();
+        }
+
+        /**
+         * @brief Release every page
+         */
+        inline void clear()
+        {
+            for (Page* page : _pages)
+                if (page != nullptr)
+                    _release(page);
+            _pages.clear();
+            _committed = 0;
+        }
+
+        /**
+         * @brief Get the number of addressable slots (pages in the table * PageSize)
+         * @return std::size_t The number of addressable slots
+         */
+        inline std::size_t size() const { return _pages.size() * PageSize; }
+
+        /**
+         * @brief Get the number of allocated pages
+         * @return std::size_t The number of allocated pages
+         */
+        inline std::size_t committedPages() const { return _committed; }
+
+        /**
+         * @brief Get the number of slots per page
+         * @return std::size_t The number of slots per page
+         */
+        static constexpr std::size_t pageSize() { return PageSize; }
+    };
 }
 }
 
@@ -575,6 +901,36 @@ class View;
  */
 struct Entity;
 
+/**
+ * @brief Fwd
+ */
+class Snapshot;
+
+/**
+ * @brief Fwd
+ */
+class Delta;
+
+/**
+ * @brief Fwd
+ */
+inline Delta diff(const Snapshot& prev, const Snapshot& cur);
+
+/**
+ * @brief Fwd
+ */
+inline void save(const registry& r, const std::string& path);
+
+/**
+ * @brief Fwd
+ */
+inline void load_mmap(registry& r, const std::string& path);
+
+/**
+ * @brief Fwd
+ */
+inline Entity move_entity(registry& from, registry& to, const Entity& e);
+
 /**
  * @brief Id of an Entity
  */
@@ -600,6 +956,17 @@ using TypeNameId = const char*;
  */
 using SystemUpdater = std::function<void(const Entity&, registry&)>;
 
+/**
+ * @brief Function giving the new Entity of an old one after a compaction
+ *        (destroyed entities are mapped to Entity(InvalidEntityId))
+ */
+using EntityRemap = std::function<Entity(const Entity&)>;
+
+/**
+ * @brief Id given to entities that do not exist anymore
+ */
+static constexpr EntityId InvalidEntityId = static_cast<EntityId>(-1);
+
 /**
  * @brief The container for a value of a view
  *
@@ -610,7 +977,7 @@ template <typename... Args>
 using ViewValue = std::tuple<Entity, Args&...>;
 
 template <typename... Args>
-using ViewContainer = std::vector<std::unique_ptr<ViewValue<Args...>>>;
+using ViewContainer = std::pmr::vector<ViewValue<Args...>>;
 
 /**
  * @brief Entity is a single ID wrapped around a struct
@@ -634,11 +1001,12 @@ struct Entity {
     {
     }
 
-    inline Entity& operator=(const Entity& other)
-    {
-        id = other.id;
-        return *this;
-    }
+    /**
+     * @brief Entities are plain ids so they stay trivially copyable
+     *        (system lists and snapshots copy them with memcpy)
+     */
+    inline Entity(const Entity& other) = default;
+    inline Entity& operator=(const Entity& other) = default;
 
     /**
      * @brief Tells if the Entity is equal to another Entity
@@ -669,545 +1037,5497 @@ struct Entity {
     }
 };
 
-namespace priv {
+/**
+ * @brief An Arena is a memory resource meant to back a whole registry
+ *        (component pools, systems entity lists and the views of the non
+ *        const registry; const views never use it) for a level
+ *        Freed blocks are recycled while the level runs and everything is
+ *        given back at once by release() when the level is unloaded
+ *        A budget can be set so allocating past it throws an Error
+ *        (release() must only be called once the registry using it is gone)
+ */
+class Arena : public std::pmr::memory_resource {
+private:
+    /**
+     * @brief The resource actually handing out the memory
+     */
+    std::pmr::unsynchronized_pool_resource _pool;
 
     /**
-     * @brief A system is a collection of entities
-     *       that are updated at a certain interval
-     *       The system requires a function to update
-     *       the entities
-     *       To make sure the entities are matching the system
-     *       we use dependencies and make them match with the entities
-     *       Dependencies are the components that the system requires
+     * @brief The maximum number of bytes in use at once (0 means no limit)
      */
-    class System {
-    private:
-        /**
-         * @brief The entities that are part of the system
-         */
-        std::vector<Entity> _entities;
+    std::size_t _budget;
 
-        /**
-         * @brief The updater function of the system
-         */
-        SystemUpdater _f;
+    /**
+     * @brief The number of bytes currently in use
+     */
+    std::size_t _used = 0;
 
-        /**
-         * @brief The dependencies of the system
-         */
-        std::vector<ComponentIndex> _dependencies;
+    /**
+     * @brief The highest number of bytes used at once
+     */
+    std::size_t _peak = 0;
 
-        /**
-         * @brief The index of the system in the registry
-         *        in case we want to remove some while iterating
-         *        It should always be reset to 0 when the system is updated
-         */
-        std::size_t _index = 0;
+protected:
+    /**
+     * @brief Allocate bytes from the arena
+     * @param bytes The number of bytes
+     * @param alignment The alignment of the block
+     * @return void* The allocated block
+     */
+    inline void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        if (_budget != 0 && _used + bytes > _budget)
+            throw Error("Arena: budget of " + std::to_string(_budget)
+                + " bytes exceeded (" + std::to_string(_used) + " used, "
+                + std::to_string(bytes) + " requested)");
+        void* p = _pool.allocate(bytes, alignment);
+        _used += bytes;
+        if (_used > _peak)
+            _peak = _used;
+        return p;
+    }
 
-    public:
+    /**
+     * @brief Give a block back to the arena
+     * @param p The block
+     * @param bytes The size of the block
+     * @param alignment The alignment of the block
+     */
+    inline void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+        _pool.deallocate(p, bytes, alignment);
+        _used -= bytes;
+    }
+
+    /**
+     * @brief Arenas are only equal to themselves
+     * @param other The other resource
+     * @return true The resources are the same
+     * @return false The resources are different
+     */
+    inline bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+public:
+    /**
+     * @brief Construct a new Arena
+     * @param budget The maximum number of bytes in use at once (0 means no limit)
+     * @param upstream The resource the arena takes its chunks from
+     */
+    inline Arena(const std::size_t& budget = 0,
+        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : _pool(upstream)
+        , _budget(budget)
+    {
+    }
+
+    /**
+     * @brief Give all the memory of the arena back to the upstream resource
+     */
+    inline void release()
+    {
+        _pool.release();
+        _used = 0;
+    }
+
+    /**
+     * @brief Set the maximum number of bytes in use at once
+     * @param budget The budget (0 means no limit)
+     */
+    inline void setBudget(const std::size_t& budget) { _budget = budget; }
+
+    /**
+     * @brief Get the maximum number of bytes in use at once
+     * @return const std::size_t& The budget (0 means no limit)
+     */
+    inline const std::size_t& budget() const { return _budget; }
+
+    /**
+     * @brief Get the number of bytes currently in use
+     * @return const std::size_t& The number of bytes in use
+     */
+    inline const std::size_t& used() const { return _used; }
+
+    /**
+     * @brief Get the highest number of bytes used at once
+     * @return const std::size_t& The peak usage
+     */
+    inline const std::size_t& peak() const { return _peak; }
+};
+
+/**
+ * @brief Memory and occupancy of a component pool
+ */
+struct PoolStats {
+    /**
+     * @brief The name of the component type (typeid)
+     */
+    std::string name;
+
+    /**
+     * @brief The number of live components
+     */
+    std::size_t count = 0;
+
+    /**
+     * @brief The number of components the pool can hold without growing
+     */
+    std::size_t capacity = 0;
+
+    /**
+     * @brief The bytes taken by the live components and their sparse index
+     */
+    std::size_t bytesUsed = 0;
+
+    /**
+     * @brief The bytes allocated by the pool
+     */
+    std::size_t bytesReserved = 0;
+
+    /**
+     * @brief The ratio of set slots in the allocated pages of the sparse index
+     */
+    double sparseFill = 0;
+};
+
+/**
+ * @brief The stages of an update, run in this order
+ *        (systems of the same stage run in the order they were added)
+ */
+enum class Stage : std::uint8_t {
+    PreUpdate,
+    Update,
+    PostUpdate,
+    RenderPrep,
+};
+
+/**
+ * @brief Get the name of the given stage
+ * @param stage The stage
+ * @return const char* The name of the stage
+ */
+inline const char* stageName(const Stage& stage)
+{
+    switch (stage) {
+    case Stage::PreUpdate:
+        return "PreUpdate";
+    case Stage::Update:
+        return "Update";
+    case Stage::PostUpdate:
+        return "PostUpdate";
+    case Stage::RenderPrep:
+        return "RenderPrep";
+    }
+    return "Unknown";
+}
+
+/**
+ * @brief Tells when a system runs (see registry::setSystemPolicy)
+ *        A pass over the entities of the system starts every `every`
+ *        updates; with a budget, a pass stops once the budget is spent and
+ *        the next updates resume it where it stopped
+ */
+struct RunPolicy {
+    /**
+     * @brief The number of updates between the start of two passes
+     */
+    std::size_t every = 1;
+
+    /**
+     * @brief The maximum time spent per update (zero for no limit)
+     */
+    std::chrono::microseconds budget = std::chrono::microseconds::zero();
+
+    /**
+     * @brief The system only runs on the updates where it returns true
+     *        (always runs if empty)
+     */
+    std::function<bool(registry&)> condition;
+};
+
+/**
+ * @brief Membership and cost of a system
+ */
+struct SystemStats {
+    /**
+     * @brief The tag of the system
+     */
+    std::string tag;
+
+    /**
+     * @brief The number of entities matching the system
+     */
+    std::size_t entities = 0;
+
+    /**
+     * @brief The time taken by the last update of the system
+     */
+    std::chrono::nanoseconds lastUpdate = std::chrono::nanoseconds::zero();
+
+    /**
+     * @brief The stage the system runs in
+     */
+    Stage stage = Stage::Update;
+
+    /**
+     * @brief The number of entities updated by the last update of the system
+     */
+    std::size_t updated = 0;
+};
+
+/**
+ * @brief The calls made on a component during a frame, by a system or
+ *        outside of the systems (see SILVA_COUNTERS)
+ */
+struct AccessStats {
+    /**
+     * @brief The name of the component type
+     */
+    std::string component;
+
+    /**
+     * @brief The tag of the system (empty outside of the systems)
+     */
+    std::string system;
+
+    /**
+     * @brief The number of entities the system updated during the frame
+     */
+    std::size_t entities = 0;
+
+    /**
+     * @brief The number of calls to get and try_get
+     */
+    std::size_t get = 0;
+
+    /**
+     * @brief The number of calls to has
+     */
+    std::size_t has = 0;
+
+    /**
+     * @brief The number of calls to emplace
+     */
+    std::size_t emplace = 0;
+
+    /**
+     * @brief The number of views built on the component
+     */
+    std::size_t views = 0;
+};
+
+/**
+ * @brief Snapshot of the memory and occupancy of a registry
+ */
+struct RegistryStats {
+    /**
+     * @brief The number of alive entities
+     */
+    std::size_t entities = 0;
+
+    /**
+     * @brief The stats of each component pool (in ComponentIndex order)
+     */
+    std::vector<PoolStats> pools;
+
+    /**
+     * @brief The stats of each system
+     */
+    std::vector<SystemStats> systems;
+};
+
+namespace priv {
+    class IPool;
+    template <typename T>
+    class Pool;
+}
+
+/**
+ * @brief Runtime description of a component type, for the pools created
+ *        by tools and data-driven loaders without a C++ type
+ *        (see registry::registerComponent(const TypeDescriptor&))
+ *        Null copy / move / destroy functions mean the components are
+ *        plain bytes: they are copied with memcpy and never destroyed
+ */
+struct TypeDescriptor {
+    /**
+     * @brief The name of the type (identifies the pool in files and deltas)
+     */
+    std::string name;
+
+    /**
+     * @brief The size of a component (a multiple of the alignment)
+     */
+    std::size_t size = 0;
+
+    /**
+     * @brief The alignment of a component (a power of two)
+     */
+    std::size_t alignment = alignof(std::max_align_t);
+
+    /**
+     * @brief Copy constructs the component at dst from the one at src
+     */
+    void (*copy)(void* dst, const void* src) = nullptr;
+
+    /**
+     * @brief Move constructs the component at dst from the one at src
+     *        (falls back to copy if null)
+     */
+    void (*move)(void* dst, void* src) = nullptr;
+
+    /**
+     * @brief Destroys the component at p
+     */
+    void (*destroy)(void* p) = nullptr;
+
+    /**
+     * @brief Creates the pool of the type (null for a RawPool), set by of()
+     *        so the C++ type gets its own Pool<T>
+     */
+    std::unique_ptr<priv::IPool> (*pool)(std::pmr::memory_resource* upstream) = nullptr;
+
+    /**
+     * @brief Tells if the components are plain bytes
+     * @return true The components can be copied with memcpy
+     * @return false The components have a copy or a destroy function
+     */
+    inline bool trivial() const
+    {
+        return copy == nullptr && move == nullptr && destroy == nullptr;
+    }
+
+    /**
+     * @brief Describes the given C++ type (registering it through the
+     *        descriptor creates the same Pool<T> as using the type)
+     * @tparam T The type of the component
+     * @return TypeDescriptor The description of the type
+     */
+    template <typename T>
+    static inline TypeDescriptor of()
+    {
+        static_assert(std::is_copy_constructible_v<T>,
+            "TypeDescriptor::of(): the type must be copy constructible");
+        TypeDescriptor type;
+        type.name = typeid(T).name();
+        type.size = sizeof(T);
+        type.alignment = alignof(T);
+        if constexpr ((std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>) == false) {
+            type.copy = [](void* dst, const void* src) { new (dst) T(*static_cast<const T*>(src)); };
+            type.move = [](void* dst, void* src) { new (dst) T(std::move(*static_cast<T*>(src))); };
+            type.destroy = [](void* p) { static_cast<T*>(p)->~T(); };
+        }
+        type.pool = [](std::pmr::memory_resource* upstream) -> std::unique_ptr<priv::IPool> {
+            return std::make_unique<priv::Pool<T>>(upstream);
+        };
+        return type;
+    }
+};
+
+/**
+ * @brief Tells if a component can be moved to another address with memcpy
+ *        (without calling its move constructor and destructor), so pools
+ *        grow, remove and sort it with raw copies
+ *        True for trivially copyable types; specialize it to opt in other
+ *        types that do not point into themselves, e.g.
+ *        template <> struct silva::is_relocatable<MyType> : std::true_type {};
+ * @tparam T The type of the component
+ */
+template <typename T>
+struct is_relocatable : std::is_trivially_copyable<T> {
+};
+
+/**
+ * @brief Tells if a component can be moved with memcpy (see is_relocatable)
+ * @tparam T The type of the component
+ */
+template <typename T>
+inline constexpr bool is_relocatable_v = is_relocatable<T>::value;
+
+namespace priv {
+
+    /**
+     * @brief Memory resource forwarding to another one and counting the
+     *        bytes it currently holds (one per component pool)
+     */
+    class CountingResource : public std::pmr::memory_resource {
+    private:
         /**
-         * @brief Construct a new System
+         * @brief The resource the memory comes from
          */
-        inline System() = default;
+        std::pmr::memory_resource* _upstream;
 
         /**
-         * @brief Set the System Update object
-         * @param f The function to update the system
+         * @brief The number of bytes currently allocated through this resource
          */
-        inline void setSystemUpdate(const SystemUpdater& f) { _f = f; }
+        std::size_t _bytes = 0;
 
+    protected:
         /**
-         * @brief Get the System Update object (uses indexes)
-         * @param dependency The dependency of the system
+         * @brief Allocate bytes from the upstream resource
+         * @param bytes The number of bytes
+         * @param alignment The alignment of the block
+         * @return void* The allocated block
          */
-        inline void addDependency(const ComponentIndex& dependency)
+        inline void* do_allocate(std::size_t bytes, std::size_t alignment) override
         {
-            if (std::find(
-                    _dependencies.begin(), _dependencies.end(), dependency)
-                != _dependencies.end())
-                return;
-            _dependencies.push_back(dependency);
+            void* p = _upstream->allocate(bytes, alignment);
+            _bytes += bytes;
+            return p;
         }
 
         /**
-         * @brief tries to see if the given entity should be part of the system
-         *        If the entity has all the dependencies of the system and is
-         * not already part of the system the entity is added to the system If
-         * the entity is already part of the system and has not all the
-         * dependencies the entity is removed from the system. Otherwise it does
-         * nothing
-         * @param r The registry
-         * @param e The entity to check
+         * @brief Give a block back to the upstream resource
+         * @param p The block
+         * @param bytes The size of the block
+         * @param alignment The alignment of the block
          */
-        inline void onEntityUpdate(registry& r, const Entity& e);
+        inline void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+        {
+            _upstream->deallocate(p, bytes, alignment);
+            _bytes -= bytes;
+        }
 
         /**
-         * @brief Remove the given entity from the system
-         * @param e The entity to remove
+         * @brief Counting resources are only equal to themselves
+         * @param other The other resource
+         * @return true The resources are the same
+         * @return false The resources are different
          */
-        inline void onEntityDelete(const Entity& e)
+        inline bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
         {
-            const std::size_t oldSize = _entities.size();
-            _entities.erase(std::remove(_entities.begin(), _entities.end(), e),
-                _entities.end());
-            const std::size_t offset = oldSize - _entities.size();
-            if (offset)
-                _index = _index < offset ? 0 : _index - offset;
+            return this == &other;
         }
 
+    public:
         /**
-         * @brief Update the system
-         * @param r The registry to use
+         * @brief Construct a new Counting Resource
+         * @param upstream The resource the memory comes from
          */
-        inline void update(registry& r)
+        inline CountingResource(std::pmr::memory_resource* upstream)
+            : _upstream(upstream)
         {
-            for (_index = 0; _index < _entities.size(); _index++)
-                _f(_entities[_index], r);
         }
+
+        /**
+         * @brief Get the number of bytes currently allocated
+         * @return const std::size_t& The number of bytes
+         */
+        inline const std::size_t& bytes() const { return _bytes; }
     };
 
-}
+    /**
+     * @brief Hash a component type name (FNV-1a) to identify it in files
+     * @param name The name of the type
+     * @return std::uint64_t The hash
+     */
+    inline std::uint64_t typeHash(const char* name)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (; *name; name++)
+            hash = (hash ^ static_cast<unsigned char>(*name)) * 1099511628211ull;
+        return hash;
+    }
 
-/**
- * @brief The registry base size for the SparseArray allocator of the entities
- *
- */
-#ifndef REGISTRY_ENTITY_SIZE
-#define REGISTRY_ENTITY_SIZE 8192
-#endif
+    /**
+     * @brief Get a new process wide type number
+     * @return std::size_t The type number
+     */
+    inline std::size_t nextTypeId()
+    {
+        static std::atomic<std::size_t> next { 0 };
+        return next++;
+    }
+
+    /**
+     * @brief Get the process wide number of the given type (dense, so it can
+     *        index a vector)
+     * @tparam T The type
+     * @return std::size_t The type number
+     */
+    template <typename T>
+    inline std::size_t typeId()
+    {
+        static const std::size_t id = nextTypeId();
+        return id;
+    }
+
+    /**
+     * @brief Tells if a component can be copied around as raw bytes
+     * @tparam T The type of the component
+     */
+    template <typename T>
+    inline constexpr bool is_bulk_copyable_v
+        = std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>;
 
 /**
- * @brief The registry base size for the SparseArray allocator of the Components
- *
+ * @brief Number of components hashed together in a snapshot to find the
+ *        changed parts of a pool quickly (see silva::diff)
  */
-#ifndef REGISTRY_COMPONENT_SIZE
-#define REGISTRY_COMPONENT_SIZE 50
+#ifndef SILVA_HASH_PAGE_SIZE
+#define SILVA_HASH_PAGE_SIZE 256
 #endif
 
-/**
- * @brief The registry is the container of all the entities and components
- *        It also contains the systems that are updated at each call of update
- *
- */
-class registry {
-private:
     /**
-     * @brief The index from template name (typeid)
+     * @brief Hash a block of bytes (reads 8 bytes at a time)
+     * @param data The bytes
+     * @param size The number of bytes
+     * @return std::uint64_t The hash
      */
-    std::unordered_map<TypeNameId, ComponentIndex> _componentToIndex;
+    inline std::uint64_t hashBytes(const unsigned char* data, const std::size_t& size)
+    {
+        std::uint64_t hash = 14695981039346656037ull ^ size;
+        std::size_t i = 0;
+
+        for (std::uint64_t word; i + sizeof(word) <= size; i += sizeof(word)) {
+            std::memcpy(&word, data + i, sizeof(word));
+            hash = (hash ^ word) * 1099511628211ull;
+            hash ^= hash >> 29;
+        }
+        for (; i < size; i++)
+            hash = (hash ^ data[i]) * 1099511628211ull;
+        return hash;
+    }
+
+    /**
+     * @brief Type erased copy of the content of a pool
+     */
+    class IPoolImage {
+    public:
+        virtual ~IPoolImage() = default;
+
+        /**
+         * @brief The hash of the name of the component type
+         */
+        std::uint64_t type = 0;
+
+        /**
+         * @brief The size of a component if it is kept as raw bytes (0 otherwise)
+         */
+        std::size_t stride = 0;
+
+        /**
+         * @brief The entity owning each component
+         */
+        std::vector<EntityId> owners;
+
+        /**
+         * @brief The hash of each SILVA_HASH_PAGE_SIZE components (raw images only)
+         */
+        std::vector<std::uint64_t> pages;
+
+        /**
+         * @brief Get the components as raw bytes
+         * @return const unsigned char* The components or nullptr if they are
+         * not kept as raw bytes
+         */
+        virtual const unsigned char* raw() const = 0;
+
+        /**
+         * @brief Get the number of bytes held by the image
+         * @return std::size_t The number of bytes
+         */
+        virtual std::size_t bytes() const = 0;
+    };
+
+    /**
+     * @brief Copy of the content of a pool
+     *        Bulk copyable components are kept as raw bytes so a whole pool
+     *        is saved and restored with a single memcpy
+     *        The buffers are reused from one capture to the next
+     * @tparam T The type of the components
+     */
+    template <typename T>
+    class PoolImage : public IPoolImage {
+    public:
+        /**
+         * @brief The components
+         */
+        std::conditional_t<is_bulk_copyable_v<T>, std::vector<unsigned char>, std::vector<T>> data;
+
+        /**
+         * @brief Get the components as raw bytes
+         * @return const unsigned char* The components or nullptr if they are
+         * not kept as raw bytes
+         */
+        inline const unsigned char* raw() const override
+        {
+            if constexpr (is_bulk_copyable_v<T>)
+                return data.data();
+            else
+                return nullptr;
+        }
+
+        /**
+         * @brief Get the number of bytes held by the image
+         * @return std::size_t The number of bytes
+         */
+        inline std::size_t bytes() const override
+        {
+            return owners.size() * (sizeof(EntityId) + sizeof(T))
+                + pages.size() * sizeof(std::uint64_t);
+        }
+    };
+
+    /**
+     * @brief Min-heap of the free entity ids that also exposes its content
+     */
+    class IdHeap : public std::priority_queue<EntityId, std::vector<EntityId>, std::greater<EntityId>> {
+    public:
+        /**
+         * @brief Get the ids held by the heap (in heap order)
+         * @return const std::vector<EntityId>& The ids
+         */
+        inline const std::vector<EntityId>& ids() const { return c; }
+    };
+
+    /**
+     * @brief Type erased part of a component pool
+     */
+    class IPool {
+    public:
+        virtual ~IPool() = default;
+
+        /**
+         * @brief Tells if the given entity has a component in the pool
+         * @param e The entity
+         * @return true The entity has the component
+         * @return false The entity does not have the component
+         */
+        virtual bool has(const EntityId& e) const = 0;
+
+        /**
+         * @brief Remove the component of the given entity (does nothing if unset)
+         * @param e The entity
+         */
+        virtual void remove(const EntityId& e) = 0;
+
+        /**
+         * @brief Get the number of components in the pool
+         * @return std::size_t The number of components
+         */
+        virtual std::size_t size() const = 0;
+
+        /**
+         * @brief Get the number of bytes allocated by the pool
+         * @return std::size_t The number of bytes
+         */
+        virtual std::size_t bytes() const = 0;
+
+        /**
+         * @brief Get the memory and occupancy of the pool
+         * @return PoolStats The stats of the pool
+         */
+        virtual PoolStats stats() const = 0;
+
+        /**
+         * @brief Renumber the owners of the components and release the unused
+         *        capacity of the pool
+         * @param remap The new id of each old entity id
+         */
+        virtual void compact(const std::vector<EntityId>& remap) = 0;
+
+        /**
+         * @brief Copy the content of the pool in the given image
+         *        (the image is created if missing or of another type)
+         * @param image The image to write to
+         */
+        virtual void save(std::unique_ptr<IPoolImage>& image) const = 0;
+
+        /**
+         * @brief Tells if the pool can be restored from the given image
+         * @param image The image to check
+         * @return true restore() accepts the image
+         * @return false restore() would throw
+         */
+        virtual bool accepts(const IPoolImage& image) const = 0;
+
+        /**
+         * @brief Replace the content of the pool by the given image
+         * @param image The image to read from
+         */
+        virtual void restore(const IPoolImage& image) = 0;
+
+        /**
+         * @brief Remove every component of the pool
+         */
+        virtual void clear() = 0;
+
+        /**
+         * @brief Get the hash of the name of the component type
+         * @return std::uint64_t The hash
+         */
+        virtual std::uint64_t hash() const = 0;
+
+        /**
+         * @brief Get the size of a component if it can be copied as raw bytes
+         * @return std::size_t The size of a component or 0 if it can not
+         */
+        virtual std::size_t stride() const = 0;
+
+        /**
+         * @brief Get the entities owning the components
+         * @return const EntityId* The entities (size() of them)
+         */
+        virtual const EntityId* owners() const = 0;
+
+        /**
+         * @brief Get the components as raw bytes
+         * @return const void* The components (size() * stride() bytes)
+         */
+        virtual const void* raw() const = 0;
+
+        /**
+         * @brief Replace the content of the pool by raw components
+         *        (only for pools with a stride)
+         * @param owners The entity owning each component
+         * @param data The components (n * stride() bytes)
+         * @param n The number of components
+         */
+        virtual void load(const EntityId* owners, const void* data, const std::size_t& n) = 0;
+
+        /**
+         * @brief Set the component of the given entity from a copy of the
+         *        given one (raw bytes for pools with a stride)
+         * @param e The entity
+         * @param data The component
+         * @return true The entity did not have the component before
+         * @return false The component of the entity was overwritten
+         */
+        virtual bool assign(const EntityId& e, const void* data) = 0;
+
+        /**
+         * @brief Get the component of the given entity if it has one
+         * @param e The entity
+         * @return void* The component (nullptr if the entity has none)
+         */
+        virtual void* find(const EntityId& e) = 0;
+
+        /**
+         * @brief Get the component of the given entity if it has one
+         * @param e The entity
+         * @return const void* The component (nullptr if the entity has none)
+         */
+        virtual const void* find(const EntityId& e) const = 0;
+
+        /**
+         * @brief Create an empty pool of the same component type
+         * @param upstream The resource the memory of the pool comes from
+         * @return std::unique_ptr<IPool> The new pool
+         */
+        virtual std::unique_ptr<IPool> create(std::pmr::memory_resource* upstream) const = 0;
+
+        /**
+         * @brief Move the component of the given entity to a pool of the same
+         *        type (of another registry), then remove it from this pool
+         * @param e The entity owning the component
+         * @param dst The pool to move the component to
+         * @param to The entity receiving the component in dst
+         * @return true The component was moved
+         * @return false The entity does not have the component
+         */
+        virtual bool moveTo(const EntityId& e, IPool& dst, const EntityId& to) = 0;
+    };
+
+    /**
+     * @brief Growable array of the components of a pool
+     *        Like a vector, except that relocatable components (see
+     *        silva::is_relocatable) are moved with memcpy when growing,
+     *        removing and reordering
+     * @tparam T The type of the components
+     */
+    template <typename T>
+    class DenseArray {
+    private:
+        /**
+         * @brief The resource the components are allocated from
+         */
+        std::pmr::memory_resource* _resource;
+
+        /**
+         * @brief The components
+         */
+        T* _data = nullptr;
+
+        /**
+         * @brief The number of components
+         */
+        std::size_t _size = 0;
+
+        /**
+         * @brief The number of components that fit in _data
+         */
+        std::size_t _capacity = 0;
+
+        /**
+         * @brief Moves a component to uninitialized memory and ends the
+         *        lifetime of the moved from component
+         * @param dst Where to move the component
+         * @param src The component to move
+         */
+        static inline void _relocate(T* dst, T* src)
+        {
+            if constexpr (is_relocatable_v<T>) {
+                std::memcpy(static_cast<void*>(dst), static_cast<const void*>(src), sizeof(T));
+            } else {
+                new (dst) T(std::move_if_noexcept(*src));
+                src->~T();
+            }
+        }
+
+        /**
+         * @brief Allocates room for the given number of components
+         * @param capacity The number of components
+         * @return T* The uninitialized memory (nullptr if capacity is 0)
+         */
+        inline T* _allocate(const std::size_t& capacity)
+        {
+            return capacity ? static_cast<T*>(_resource->allocate(capacity * sizeof(T), alignof(T)))
+                            : nullptr;
+        }
+
+        /**
+         * @brief Replaces the buffer by the given one of the given capacity
+         * @param data The new buffer (the components were already moved)
+         * @param capacity The number of components of the new buffer
+         */
+        inline void _replace(T* data, const std::size_t& capacity)
+        {
+            if (_data)
+                _resource->deallocate(_data, _capacity * sizeof(T), alignof(T));
+            _data = data;
+            _capacity = capacity;
+        }
+
+        /**
+         * @brief Moves the components to a buffer of the given capacity
+         * @param capacity The number of components of the new buffer
+         */
+        inline void _reallocate(const std::size_t& capacity)
+        {
+            T* data = _allocate(capacity);
+
+            if constexpr (is_relocatable_v<T>) {
+                if (_size)
+                    std::memcpy(static_cast<void*>(data), static_cast<const void*>(_data), _size * sizeof(T));
+            } else {
+                for (std::size_t i = 0; i < _size; i++)
+                    _relocate(data + i, _data + i);
+            }
+            _replace(data, capacity);
+        }
+
+        /**
+         * @brief Makes room for at least one more component
+         */
+        inline void _grow()
+        {
+            if (_size == _capacity)
+                _reallocate(std::max<std::size_t>(_capacity * 2, 8));
+        }
+
+    public:
+        /**
+         * @brief Construct a new Dense Array
+         * @param resource The resource the components are allocated from
+         */
+        inline DenseArray(std::pmr::memory_resource* resource)
+            : _resource(resource)
+        {
+        }
+
+        DenseArray(const DenseArray&) = delete;
+        DenseArray& operator=(const DenseArray&) = delete;
+
+        /**
+         * @brief Destroy the Dense Array and its components
+         */
+        inline ~DenseArray()
+        {
+            clear();
+            _replace(nullptr, 0);
+        }
+
+        /**
+         * @brief Get the component at the given position
+         * @param i The position
+         * @return T& The component
+         */
+        inline T& operator[](const std::size_t& i) { return _data[i]; }
+
+        /**
+         * @brief Get the component at the given position
+         * @param i The position
+         * @return const T& The component
+         */
+        inline const T& operator[](const std::size_t& i) const { return _data[i]; }
+
+        /**
+         * @brief Get the last component
+         * @return T& The component
+         */
+        inline T& back() { return _data[_size - 1]; }
+
+        /**
+         * @brief Get the components
+         * @return T* The components (size() of them)
+         */
+        inline T* data() { return _data; }
+
+        /**
+         * @brief Get the components
+         * @return const T* The components (size() of them)
+         */
+        inline const T* data() const { return _data; }
+
+        /**
+         * @brief Get the first component (to iterate)
+         * @return T* The first component
+         */
+        inline T* begin() { return _data; }
+
+        /**
+         * @brief Get the first component (to iterate)
+         * @return const T* The first component
+         */
+        inline const T* begin() const { return _data; }
+
+        /**
+         * @brief Get the end of the components (to iterate)
+         * @return T* The end of the components
+         */
+        inline T* end() { return _data + _size; }
+
+        /**
+         * @brief Get the end of the components (to iterate)
+         * @return const T* The end of the components
+         */
+        inline const T* end() const { return _data + _size; }
+
+        /**
+         * @brief Get the number of components
+         * @return std::size_t The number of components
+         */
+        inline std::size_t size() const { return _size; }
+
+        /**
+         * @brief Get the number of components that fit without growing
+         * @return std::size_t The capacity
+         */
+        inline std::size_t capacity() const { return _capacity; }
+
+        /**
+         * @brief Tells if the array has no component
+         * @return true The array is empty
+         * @return false The array has components
+         */
+        inline bool empty() const { return _size == 0; }
+
+        /**
+         * @brief Reserve room for the given number of components
+         * @param n The number of components
+         */
+        inline void reserve(const std::size_t& n)
+        {
+            if (n > _capacity)
+                _reallocate(n);
+        }
+
+        /**
+         * @brief Release the unused capacity
+         */
+        inline void shrink_to_fit()
+        {
+            if (_size != _capacity)
+                _reallocate(_size);
+        }
+
+        /**
+         * @brief Construct a component at the end of the array
+         *        (the arguments must not refer to a component of the array)
+         * @param args The arguments of the constructor
+         * @tparam Args The types of the arguments
+         * @return T& The new component
+         */
+        template <typename... Args>
+        inline T& emplace_back(Args&&... args)
+        {
+            _grow();
+            new (_data + _size) T(std::forward<Args>(args)...);
+            return _data[_size++];
+        }
+
+        /**
+         * @brief Append copies of a component
+         * @param n The number of copies
+         * @param value The component to copy
+         */
+        inline void append(const std::size_t& n, const T& value)
+        {
+            reserve(_size + n);
+            for (std::size_t i = 0; i < n; i++)
+                new (_data + _size + i) T(value);
+            _size += n;
+        }
+
+        /**
+         * @brief Destroy the last component
+         */
+        inline void pop_back() { _data[--_size].~T(); }
+
+        /**
+         * @brief Destroy the component at the given position and move the
+         *        last component in its place
+         * @param i The position
+         */
+        inline void eraseSwap(const std::size_t& i)
+        {
+            if constexpr (is_relocatable_v<T>) {
+                _data[i].~T();
+                if (i + 1 != _size)
+                    _relocate(_data + i, _data + _size - 1);
+                _size--;
+            } else {
+                if (i + 1 != _size)
+                    _data[i] = std::move(_data[_size - 1]);
+                pop_back();
+            }
+        }
+
+        /**
+         * @brief Swap the components at the given positions
+         * @param a The first position
+         * @param b The second position
+         */
+        inline void swap(const std::size_t& a, const std::size_t& b)
+        {
+            if constexpr (is_relocatable_v<T>) {
+                alignas(T) unsigned char tmp[sizeof(T)];
+                std::memcpy(tmp, static_cast<const void*>(_data + a), sizeof(T));
+                std::memcpy(static_cast<void*>(_data + a), static_cast<const void*>(_data + b), sizeof(T));
+                std::memcpy(static_cast<void*>(_data + b), tmp, sizeof(T));
+            } else {
+                std::swap(_data[a], _data[b]);
+            }
+        }
+
+        /**
+         * @brief Reorders the components: the component at order[i] moves
+         *        to the position i (order is a permutation of the positions)
+         * @param order The old position of each component
+         */
+        inline void permute(const std::vector<std::size_t>& order)
+        {
+            T* data = _allocate(_capacity);
+
+            for (std::size_t i = 0; i < _size; i++)
+                _relocate(data + i, _data + order[i]);
+            _replace(data, _capacity);
+        }
+
+        /**
+         * @brief Resize the array (new components are value initialized)
+         * @param n The number of components
+         */
+        inline void resize(const std::size_t& n)
+        {
+            while (_size > n)
+                pop_back();
+            reserve(n);
+            for (; _size < n; _size++)
+                new (_data + _size) T();
+        }
+
+        /**
+         * @brief Replace the content of the array by copies of the given
+         *        components
+         * @param first The first component
+         * @param last The end of the components
+         * @tparam It The type of the iterators
+         */
+        template <typename It>
+        inline void assign(It first, It last)
+        {
+            clear();
+            reserve(std::distance(first, last));
+            for (; first != last; ++first, _size++)
+                new (_data + _size) T(*first);
+        }
+
+        /**
+         * @brief Destroy every component (keeps the capacity)
+         */
+        inline void clear()
+        {
+            if constexpr (std::is_trivially_destructible_v<T> == false)
+                for (std::size_t i = 0; i < _size; i++)
+                    _data[i].~T();
+            _size = 0;
+        }
+    };
+
+    /**
+     * @brief A Pool stores every component of a single type contiguously
+     *        A paged sparse index maps an entity to its slot in the dense
+     *        arrays, and removing swaps the last component in the hole
+     *        All the memory of the pool comes from the given resource
+     * @tparam T The type of the components
+     */
+    template <typename T>
+    class Pool : public IPool {
+    private:
+        /**
+         * @brief The resource counting the memory used by the pool
+         */
+        CountingResource _resource;
+
+        /**
+         * @brief The components
+         */
+        DenseArray<T> _dense;
+
+        /**
+         * @brief The entity owning each component of _dense
+         */
+        std::pmr::vector<EntityId> _owners;
+
+        /**
+         * @brief The slot of each entity in _dense + 1 (0 means unset)
+         */
+        PagedArray<std::size_t> _sparse;
+
+        /**
+         * @brief The next slot to insert of the incremental sort (see sortStep)
+         */
+        std::size_t _sortCursor = 1;
+
+        /**
+         * @brief The slot of the component being inserted by the incremental
+         *        sort when the last call ran out of budget (0 if none)
+         */
+        std::size_t _sortHole = 0;
+
+    public:
+        /**
+         * @brief Construct a new Pool
+         * @param upstream The resource the memory of the pool comes from
+         */
+        inline Pool(std::pmr::memory_resource* upstream)
+            : _resource(upstream)
+            , _dense(&_resource)
+            , _owners(&_resource)
+            , _sparse(&_resource)
+        {
+        }
+
+        /**
+         * @brief Tells if the given entity has a component in the pool
+         * @param e The entity
+         * @return true The entity has the component
+         * @return false The entity does not have the component
+         */
+        inline bool has(const EntityId& e) const override
+        {
+            const std::size_t* slot = _sparse.find(e);
+            return slot != nullptr && *slot != 0;
+        }
+
+        /**
+         * @brief Get the component of the given entity
+         * @param e The entity
+         * @return T& The component
+         */
+        inline T& get(const EntityId& e)
+        {
+#if SILVA_CHECKED
+            const std::size_t* slot = _sparse.find(e);
+            if (slot == nullptr || *slot == 0)
+                throw Error("Trying to get a value at an unset index: "
+                    + std::to_string(e));
+            return _dense[*slot - 1];
+#else
+            return _dense[_sparse[e] - 1];
+#endif
+        }
+
+        /**
+         * @brief Get the component of the given entity
+         * @param e The entity
+         * @return const T& The component
+         */
+        inline const T& get(const EntityId& e) const
+        {
+#if SILVA_CHECKED
+            const std::size_t* slot = _sparse.find(e);
+            if (slot == nullptr || *slot == 0)
+                throw Error("Trying to get a value at an unset index: "
+                    + std::to_string(e));
+            return _dense[*slot - 1];
+#else
+            return _dense[_sparse[e] - 1];
+#endif
+        }
+
+        /**
+         * @brief Get the component of the given entity if it has one
+         * @param e The entity
+         * @return T* The component (nullptr if the entity has none)
+         */
+        inline T* tryGet(const EntityId& e)
+        {
+            const std::size_t* slot = _sparse.find(e);
+            return slot == nullptr || *slot == 0 ? nullptr : &_dense[*slot - 1];
+        }
+
+        /**
+         * @brief Get the component of the given entity if it has one
+         * @param e The entity
+         * @return const T* The component (nullptr if the entity has none)
+         */
+        inline const T* tryGet(const EntityId& e) const
+        {
+            const std::size_t* slot = _sparse.find(e);
+            return slot == nullptr || *slot == 0 ? nullptr : &_dense[*slot - 1];
+        }
+
+        /**
+         * @brief Set the component of the given entity (replaces the old one)
+         * @param e The entity
+         * @param value The component
+         * @return T& The stored component
+         */
+        inline T& emplace(const EntityId& e, T&& value)
+        {
+            std::size_t& slot = _sparse.at(e);
+            if (slot != 0)
+                return _dense[slot - 1] = std::move(value);
+            _dense.emplace_back(std::move(value));
+            _owners.push_back(e);
+            slot = _dense.size();
+            return _dense.back();
+        }
+
+        /**
+         * @brief Give a copy of the value to every given entity at once
+         *        (the entities must not have the component yet)
+         *        Trivially copyable values are copied with memcpy
+         * @param es The entities
+         * @param value The value to copy
+         */
+        inline void emplaceMany(const std::vector<Entity>& es, const T& value)
+        {
+            const std::size_t start = _dense.size();
+            const std::size_t n = es.size();
+
+            if (n == 0)
+                return;
+            if constexpr (is_bulk_copyable_v<T>) {
+                _dense.resize(start + n);
+                std::memcpy(&_dense[start], &value, sizeof(T));
+                for (std::size_t done = 1; done < n; done *= 2)
+                    std::memcpy(&_dense[start + done], &_dense[start],
+                        std::min(done, n - done) * sizeof(T));
+            } else {
+                _dense.append(n, value);
+            }
+            _owners.reserve(start + n);
+            for (std::size_t i = 0; i < n; i++) {
+                _owners.push_back(es[i].id);
+                _sparse.at(es[i].id) = start + i + 1;
+            }
+        }
+
+        /**
+         * @brief Remove the component of the given entity (does nothing if unset)
+         *        The last component of the pool is moved into the freed slot
+         * @param e The entity
+         */
+        inline void remove(const EntityId& e) override
+        {
+            std::size_t* slot = _sparse.find(e);
+            if (slot == nullptr || *slot == 0)
+                return;
+            const std::size_t i = *slot - 1;
+            if (i + 1 != _dense.size()) {
+                _owners[i] = _owners.back();
+                *_sparse.find(_owners[i]) = i + 1;
+            }
+            _dense.eraseSwap(i);
+            _owners.pop_back();
+            *slot = 0;
+        }
+
+        /**
+         * @brief Swap the components at the given slots
+         * @param a The first slot
+         * @param b The second slot
+         */
+        inline void swap(const std::size_t& a, const std::size_t& b)
+        {
+            _dense.swap(a, b);
+            std::swap(_owners[a], _owners[b]);
+            _sparse.at(_owners[a]) = a + 1;
+            _sparse.at(_owners[b]) = b + 1;
+        }
+
+        /**
+         * @brief Sorts all the components by the given key at once
+         * @param key Computes the key of a component
+         * @tparam K The type of the key function
+         */
+        template <typename K>
+        inline void sort(const K& key)
+        {
+            std::vector<std::pair<decltype(key(std::declval<const T&>())), std::size_t>> order;
+
+            order.reserve(_dense.size());
+            for (std::size_t i = 0; i < _dense.size(); i++)
+                order.emplace_back(key(_dense[i]), i);
+            std::sort(order.begin(), order.end());
+            std::vector<std::size_t> positions(order.size());
+            std::pmr::vector<EntityId> owners(&_resource);
+            owners.reserve(_owners.capacity());
+            for (std::size_t i = 0; i < order.size(); i++) {
+                positions[i] = order[i].second;
+                owners.push_back(_owners[order[i].second]);
+                _sparse.at(owners.back()) = i + 1;
+            }
+            _dense.permute(positions);
+            _owners.swap(owners);
+            _sortCursor = 1;
+            _sortHole = 0;
+        }
+
+        /**
+         * @brief Runs a bounded part of an insertion sort of the components
+         *        by the given key, resuming where the last call stopped
+         *        (cheap when the order is already nearly sorted)
+         * @param key Computes the key of a component
+         * @param budget The maximum number of moves
+         * @tparam K The type of the key function
+         * @return true The sorting pass reached the end of the pool
+         * @return false The sorting pass is not over
+         */
+        template <typename K>
+        inline bool sortStep(const K& key, std::size_t budget)
+        {
+            while (budget > 0) {
+                if (_sortHole == 0 || _sortHole >= _dense.size()) {
+                    if (_sortCursor >= _dense.size()) {
+                        _sortCursor = 1;
+                        _sortHole = 0;
+                        return true;
+                    }
+                    _sortHole = _sortCursor++;
+                }
+                const auto k = key(_dense[_sortHole]);
+                for (; _sortHole > 0 && budget > 0 && k < key(_dense[_sortHole - 1]); _sortHole--, budget--)
+                    swap(_sortHole, _sortHole - 1);
+                if (budget == 0 && _sortHole > 0 && k < key(_dense[_sortHole - 1]))
+                    return false;
+                _sortHole = 0;
+                budget -= budget > 0;
+            }
+            return false;
+        }
+
+        /**
+         * @brief Reserve room for the given number of components
+         * @param n The number of components
+         */
+        inline void reserve(const std::size_t& n)
+        {
+            _dense.reserve(n);
+            _owners.reserve(n);
+        }
+
+        /**
+         * @brief Get the number of components in the pool
+         * @return std::size_t The number of components
+         */
+        inline std::size_t size() const override { return _dense.size(); }
+
+        /**
+         * @brief Get the number of bytes allocated by the pool
+         * @return std::size_t The number of bytes
+         */
+        inline std::size_t bytes() const override { return _resource.bytes(); }
+
+        /**
+         * @brief Get the memory and occupancy of the pool
+         * @return PoolStats The stats of the pool
+         */
+        inline PoolStats stats() const override
+        {
+            PoolStats s;
+            const std::size_t slots = _sparse.committedPages() * _sparse.pageSize();
+            s.name = typeid(T).name();
+            s.count = _dense.size();
+            s.capacity = _dense.capacity();
+            s.bytesUsed = s.count * (sizeof(T) + sizeof(EntityId))
+                + slots * sizeof(std::size_t);
+            s.bytesReserved = _resource.bytes();
+            s.sparseFill = slots ? static_cast<double>(s.count) / slots : 0;
+            return s;
+        }
+
+        /**
+         * @brief Renumber the owners of the components and release the unused
+         *        capacity of the pool (the sparse index is rebuilt from scratch
+         *        so pages that are not needed anymore are given back)
+         * @param remap The new id of each old entity id
+         */
+        inline void compact(const std::vector<EntityId>& remap) override
+        {
+            _sparse.clear();
+            for (std::size_t i = 0; i < _owners.size(); i++) {
+                _owners[i] = remap[_owners[i]];
+                _sparse.at(_owners[i]) = i + 1;
+            }
+            _dense.shrink_to_fit();
+            _owners.shrink_to_fit();
+        }
+
+        /**
+         * @brief Copy the content of the pool in the given image
+         *        (the image is created if missing or of another type)
+         * @param image The image to write to
+         */
+        inline void save(std::unique_ptr<IPoolImage>& image) const override
+        {
+            auto* out = dynamic_cast<PoolImage<T>*>(image.get());
+            if (out == nullptr) {
+                image = std::make_unique<PoolImage<T>>();
+                out = static_cast<PoolImage<T>*>(image.get());
+            }
+            out->type = hash();
+            out->stride = stride();
+            out->owners.assign(_owners.begin(), _owners.end());
+            if constexpr (is_bulk_copyable_v<T>) {
+                constexpr std::size_t page = SILVA_HASH_PAGE_SIZE * sizeof(T);
+                out->data.resize(_dense.size() * sizeof(T));
+                if (_dense.empty() == false)
+                    std::memcpy(out->data.data(), _dense.data(), out->data.size());
+                out->pages.resize((out->data.size() + page - 1) / page);
+                for (std::size_t i = 0; i < out->pages.size(); i++)
+                    out->pages[i] = hashBytes(out->data.data() + i * page,
+                        std::min(page, out->data.size() - i * page));
+            } else {
+                out->data.assign(_dense.begin(), _dense.end());
+            }
+        }
+
+        /**
+         * @brief Tells if the pool can be restored from the given image
+         *        Bulk copyable pools also accept the raw bytes saved while
+         *        the type was only known by its descriptor
+         * @param image The image to check
+         * @return true restore() accepts the image
+         * @return false restore() would throw
+         */
+        inline bool accepts(const IPoolImage& image) const override
+        {
+            if (dynamic_cast<const PoolImage<T>*>(&image) != nullptr)
+                return true;
+            return is_bulk_copyable_v<T> && image.type == hash() && image.raw() != nullptr
+                && image.stride == sizeof(T);
+        }
+
+        /**
+         * @brief Replace the content of the pool by the given image
+         * @param image The image to read from
+         */
+        inline void restore(const IPoolImage& image) override
+        {
+            if (accepts(image) == false)
+                throw Error(std::string("restore(): the image does not match the pool of ")
+                    + typeid(T).name());
+            const bool sameOwners = std::equal(
+                _owners.begin(), _owners.end(), image.owners.begin(), image.owners.end());
+            if (sameOwners == false) {
+                for (const auto& e : _owners)
+                    *_sparse.find(e) = 0;
+                _owners.assign(image.owners.begin(), image.owners.end());
+            }
+            if constexpr (is_bulk_copyable_v<T>) {
+                _dense.resize(_owners.size());
+                if (_dense.empty() == false)
+                    std::memcpy(_dense.data(), image.raw(), _dense.size() * sizeof(T));
+            } else {
+                const auto& in = static_cast<const PoolImage<T>&>(image);
+                _dense.assign(in.data.begin(), in.data.end());
+            }
+            if (sameOwners == false)
+                for (std::size_t i = 0; i < _owners.size(); i++)
+                    _sparse.at(_owners[i]) = i + 1;
+        }
+
+        /**
+         * @brief Remove every component of the pool
+         */
+        inline void clear() override
+        {
+            for (const auto& e : _owners)
+                *_sparse.find(e) = 0;
+            _owners.clear();
+            _dense.clear();
+        }
+
+        /**
+         * @brief Get the hash of the name of the component type
+         * @return std::uint64_t The hash
+         */
+        inline std::uint64_t hash() const override { return typeHash(typeid(T).name()); }
+
+        /**
+         * @brief Get the size of a component if it can be copied as raw bytes
+         * @return std::size_t The size of a component or 0 if it can not
+         */
+        inline std::size_t stride() const override
+        {
+            return is_bulk_copyable_v<T> ? sizeof(T) : 0;
+        }
+
+        /**
+         * @brief Get the entities owning the components
+         * @return const EntityId* The entities (size() of them)
+         */
+        inline const EntityId* owners() const override { return _owners.data(); }
+
+        /**
+         * @brief Get the components as raw bytes
+         * @return const void* The components (size() * stride() bytes)
+         */
+        inline const void* raw() const override { return _dense.data(); }
+
+        /**
+         * @brief Replace the content of the pool by raw components
+         *        (only for pools with a stride)
+         * @param owners The entity owning each component
+         * @param data The components (n * stride() bytes)
+         * @param n The number of components
+         */
+        inline void load(const EntityId* owners, const void* data, const std::size_t& n) override
+        {
+            if constexpr (is_bulk_copyable_v<T>) {
+                clear();
+                _owners.assign(owners, owners + n);
+                _dense.resize(n);
+                if (n)
+                    std::memcpy(_dense.data(), data, n * sizeof(T));
+                for (std::size_t i = 0; i < n; i++)
+                    _sparse.at(_owners[i]) = i + 1;
+            } else {
+                (void)owners;
+                (void)data;
+                (void)n;
+                throw Error(std::string("load(): ") + typeid(T).name()
+                    + " can not be loaded from raw bytes");
+            }
+        }
+
+        /**
+         * @brief Set the component of the given entity from a copy of the
+         *        given one (raw bytes for pools with a stride)
+         * @param e The entity
+         * @param data The component
+         * @return true The entity did not have the component before
+         * @return false The component of the entity was overwritten
+         */
+        inline bool assign(const EntityId& e, const void* data) override
+        {
+            if constexpr (is_bulk_copyable_v<T>) {
+                std::size_t& slot = _sparse.at(e);
+                if (slot != 0) {
+                    std::memcpy(&_dense[slot - 1], data, sizeof(T));
+                    return false;
+                }
+                _dense.emplace_back();
+                std::memcpy(&_dense.back(), data, sizeof(T));
+                _owners.push_back(e);
+                slot = _dense.size();
+                return true;
+            } else if constexpr (std::is_copy_constructible_v<T>) {
+                const bool added = has(e) == false;
+                emplace(e, T(*static_cast<const T*>(data)));
+                return added;
+            } else {
+                (void)e;
+                (void)data;
+                throw Error(std::string("assign(): ") + typeid(T).name()
+                    + " can not be copied");
+            }
+        }
+
+        /**
+         * @brief Get the component of the given entity if it has one
+         * @param e The entity
+         * @return void* The component (nullptr if the entity has none)
+         */
+        inline void* find(const EntityId& e) override { return tryGet(e); }
+
+        /**
+         * @brief Get the component of the given entity if it has one
+         * @param e The entity
+         * @return const void* The component (nullptr if the entity has none)
+         */
+        inline const void* find(const EntityId& e) const override { return tryGet(e); }
+
+        /**
+         * @brief Create an empty pool of the same component type
+         * @param upstream The resource the memory of the pool comes from
+         * @return std::unique_ptr<IPool> The new pool
+         */
+        inline std::unique_ptr<IPool> create(std::pmr::memory_resource* upstream) const override
+        {
+            return std::make_unique<Pool<T>>(upstream);
+        }
+
+        /**
+         * @brief Move the component of the given entity to a pool of the same
+         *        type (of another registry), then remove it from this pool
+         * @param e The entity owning the component
+         * @param dst The pool to move the component to
+         * @param to The entity receiving the component in dst
+         * @return true The component was moved
+         * @return false The entity does not have the component
+         */
+        inline bool moveTo(const EntityId& e, IPool& dst, const EntityId& to) override
+        {
+            T* value = tryGet(e);
+            if (value == nullptr)
+                return false;
+            if (auto* typed = dynamic_cast<Pool<T>*>(&dst))
+                typed->emplace(to, std::move(*value));
+            else
+                dst.assign(to, value);
+            remove(e);
+            return true;
+        }
+
+        /**
+         * @brief Get the entities owning the components (same order as data())
+         * @return const std::pmr::vector<EntityId>& The entities
+         */
+        inline const std::pmr::vector<EntityId>& entities() const { return _owners; }
+
+        /**
+         * @brief Get the components
+         * @return DenseArray<T>& The components
+         */
+        inline DenseArray<T>& data() { return _dense; }
+
+        /**
+         * @brief Get the components
+         * @return const DenseArray<T>& The components
+         */
+        inline const DenseArray<T>& data() const { return _dense; }
+    };
+
+    /**
+     * @brief Growable array of components only known by their TypeDescriptor
+     *        (the vector of the raw pools and of their images)
+     */
+    class RawArray {
+    private:
+        /**
+         * @brief The type of the components
+         */
+        TypeDescriptor _type;
+
+        /**
+         * @brief The resource the components are allocated from
+         */
+        std::pmr::memory_resource* _resource;
+
+        /**
+         * @brief The components
+         */
+        unsigned char* _data = nullptr;
+
+        /**
+         * @brief The number of components
+         */
+        std::size_t _size = 0;
+
+        /**
+         * @brief The number of components that fit in _data
+         */
+        std::size_t _capacity = 0;
+
+        /**
+         * @brief Copy constructs a component
+         * @param dst Where to construct the component
+         * @param src The component to copy
+         */
+        inline void _copy(void* dst, const void* src) const
+        {
+            if (_type.copy)
+                _type.copy(dst, src);
+            else
+                std::memcpy(dst, src, _type.size);
+        }
+
+        /**
+         * @brief Moves a component to uninitialized memory and destroys the
+         *        moved from component
+         * @param dst Where to construct the component
+         * @param src The component to move
+         */
+        inline void _relocate(void* dst, void* src) const
+        {
+            if (_type.move)
+                _type.move(dst, src);
+            else
+                _copy(dst, src);
+            if (_type.destroy)
+                _type.destroy(src);
+        }
+
+        /**
+         * @brief Moves the components to a buffer of the given capacity
+         * @param capacity The number of components of the new buffer
+         */
+        inline void _reallocate(const std::size_t& capacity)
+        {
+            unsigned char* data = capacity
+                ? static_cast<unsigned char*>(_resource->allocate(capacity * _type.size, _type.alignment))
+                : nullptr;
+
+            if (_type.trivial()) {
+                if (_size)
+                    std::memcpy(data, _data, _size * _type.size);
+            } else {
+                for (std::size_t i = 0; i < _size; i++)
+                    _relocate(data + i * _type.size, _data + i * _type.size);
+            }
+            if (_data)
+                _resource->deallocate(_data, _capacity * _type.size, _type.alignment);
+            _data = data;
+            _capacity = capacity;
+        }
+
+    public:
+        /**
+         * @brief Construct a new Raw Array
+         * @param type The type of the components
+         * @param resource The resource the components are allocated from
+         */
+        inline RawArray(const TypeDescriptor& type, std::pmr::memory_resource* resource)
+            : _type(type)
+            , _resource(resource)
+        {
+            if (_type.size == 0 || _type.alignment == 0
+                || (_type.alignment & (_type.alignment - 1)) != 0
+                || _type.size % _type.alignment != 0)
+                throw Error("RawArray(): invalid size or alignment for " + _type.name);
+        }
+
+        RawArray(const RawArray&) = delete;
+        RawArray& operator=(const RawArray&) = delete;
+
+        /**
+         * @brief Destroy the Raw Array and its components
+         */
+        inline ~RawArray()
+        {
+            clear();
+            _reallocate(0);
+        }
+
+        /**
+         * @brief Get the type of the components
+         * @return const TypeDescriptor& The type
+         */
+        inline const TypeDescriptor& type() const { return _type; }
+
+        /**
+         * @brief Get the component at the given position
+         * @param i The position
+         * @return void* The component
+         */
+        inline void* operator[](const std::size_t& i) { return _data + i * _type.size; }
+
+        /**
+         * @brief Get the component at the given position
+         * @param i The position
+         * @return const void* The component
+         */
+        inline const void* operator[](const std::size_t& i) const { return _data + i * _type.size; }
+
+        /**
+         * @brief Get the components
+         * @return const void* The components (size() of them)
+         */
+        inline const void* data() const { return _data; }
+
+        /**
+         * @brief Get the number of components
+         * @return std::size_t The number of components
+         */
+        inline std::size_t size() const { return _size; }
+
+        /**
+         * @brief Get the number of components that fit without growing
+         * @return std::size_t The capacity
+         */
+        inline std::size_t capacity() const { return _capacity; }
+
+        /**
+         * @brief Reserve room for the given number of components
+         * @param n The number of components
+         */
+        inline void reserve(const std::size_t& n)
+        {
+            if (n > _capacity)
+                _reallocate(n);
+        }
+
+        /**
+         * @brief Append a copy of the given component
+         * @param value The component
+         */
+        inline void push_back(const void* value)
+        {
+            if (_size == _capacity)
+                _reallocate(std::max<std::size_t>(_capacity * 2, 8));
+            _copy(_data + _size * _type.size, value);
+            _size++;
+        }
+
+        /**
+         * @brief Replace the component at the given position by a copy
+         * @param i The position
+         * @param value The component
+         */
+        inline void set(const std::size_t& i, const void* value)
+        {
+            void* dst = (*this)[i];
+            if (dst == value)
+                return;
+            if (_type.destroy)
+                _type.destroy(dst);
+            _copy(dst, value);
+        }
+
+        /**
+         * @brief Move the last component to the given position, replacing
+         *        the component there, and shrink the array by one
+         * @param i The position
+         */
+        inline void eraseSwap(const std::size_t& i)
+        {
+            void* last = (*this)[_size - 1];
+            if (_type.destroy)
+                _type.destroy((*this)[i]);
+            if (i + 1 != _size)
+                _relocate((*this)[i], last);
+            _size--;
+        }
+
+        /**
+         * @brief Replace the content of the array by copies of the given
+         *        components
+         * @param data The components
+         * @param n The number of components
+         */
+        inline void assign(const void* data, const std::size_t& n)
+        {
+            clear();
+            reserve(n);
+            if (_type.trivial()) {
+                if (n)
+                    std::memcpy(_data, data, n * _type.size);
+            } else {
+                for (std::size_t i = 0; i < n; i++)
+                    _copy(_data + i * _type.size, static_cast<const unsigned char*>(data) + i * _type.size);
+            }
+            _size = n;
+        }
+
+        /**
+         * @brief Destroy every component (keeps the capacity)
+         */
+        inline void clear()
+        {
+            if (_type.destroy)
+                for (std::size_t i = 0; i < _size; i++)
+                    _type.destroy((*this)[i]);
+            _size = 0;
+        }
+
+        /**
+         * @brief Release the unused capacity
+         */
+        inline void shrink_to_fit()
+        {
+            if (_size != _capacity)
+                _reallocate(_size);
+        }
+    };
+
+    /**
+     * @brief Copy of the content of a raw pool
+     */
+    class RawPoolImage : public IPoolImage {
+    public:
+        /**
+         * @brief The components
+         */
+        RawArray data;
+
+        /**
+         * @brief Construct a new Raw Pool Image
+         * @param type The type of the components
+         */
+        inline RawPoolImage(const TypeDescriptor& type)
+            : data(type, std::pmr::new_delete_resource())
+        {
+        }
+
+        /**
+         * @brief Get the components as raw bytes
+         * @return const unsigned char* The components or nullptr if they are
+         * not kept as raw bytes
+         */
+        inline const unsigned char* raw() const override
+        {
+            return data.type().trivial() ? static_cast<const unsigned char*>(data.data()) : nullptr;
+        }
+
+        /**
+         * @brief Get the number of bytes held by the image
+         * @return std::size_t The number of bytes
+         */
+        inline std::size_t bytes() const override
+        {
+            return owners.size() * (sizeof(EntityId) + data.type().size)
+                + pages.size() * sizeof(std::uint64_t);
+        }
+    };
+
+    /**
+     * @brief A pool of components described at runtime by a TypeDescriptor
+     *        Same layout as Pool<T>: a dense array of components, their
+     *        owners and a paged sparse index, so systems, snapshots and
+     *        files treat it like any other pool
+     */
+    class RawPool : public IPool {
+    private:
+        /**
+         * @brief The resource counting the memory used by the pool
+         */
+        CountingResource _resource;
+
+        /**
+         * @brief The components
+         */
+        RawArray _dense;
+
+        /**
+         * @brief The entity owning each component of _dense
+         */
+        std::pmr::vector<EntityId> _owners;
+
+        /**
+         * @brief The slot of each entity in _dense + 1 (0 means unset)
+         */
+        PagedArray<std::size_t> _sparse;
+
+    public:
+        /**
+         * @brief Construct a new Raw Pool
+         * @param type The type of the components
+         * @param upstream The resource the memory of the pool comes from
+         */
+        inline RawPool(const TypeDescriptor& type, std::pmr::memory_resource* upstream)
+            : _resource(upstream)
+            , _dense(type, &_resource)
+            , _owners(&_resource)
+            , _sparse(&_resource)
+        {
+        }
+
+        /**
+         * @brief Get the type of the components
+         * @return const TypeDescriptor& The type
+         */
+        inline const TypeDescriptor& type() const { return _dense.type(); }
+
+        /**
+         * @brief Tells if the given entity has a component in the pool
+         * @param e The entity
+         * @return true The entity has the component
+         * @return false The entity does not have the component
+         */
+        inline bool has(const EntityId& e) const override
+        {
+            const std::size_t* slot = _sparse.find(e);
+            return slot != nullptr && *slot != 0;
+        }
+
+        /**
+         * @brief Remove the component of the given entity (does nothing if unset)
+         *        The last component of the pool is moved into the freed slot
+         * @param e The entity
+         */
+        inline void remove(const EntityId& e) override
+        {
+            std::size_t* slot = _sparse.find(e);
+            if (slot == nullptr || *slot == 0)
+                return;
+            const std::size_t i = *slot - 1;
+            _dense.eraseSwap(i);
+            if (i != _owners.size() - 1) {
+                _owners[i] = _owners.back();
+                *_sparse.find(_owners[i]) = i + 1;
+            }
+            _owners.pop_back();
+            *slot = 0;
+        }
+
+        /**
+         * @brief Get the number of components in the pool
+         * @return std::size_t The number of components
+         */
+        inline std::size_t size() const override { return _dense.size(); }
+
+        /**
+         * @brief Get the number of bytes allocated by the pool
+         * @return std::size_t The number of bytes
+         */
+        inline std::size_t bytes() const override { return _resource.bytes(); }
+
+        /**
+         * @brief Get the memory and occupancy of the pool
+         * @return PoolStats The stats of the pool
+         */
+        inline PoolStats stats() const override
+        {
+            PoolStats s;
+            const std::size_t slots = _sparse.committedPages() * _sparse.pageSize();
+            s.name = type().name;
+            s.count = _dense.size();
+            s.capacity = _dense.capacity();
+            s.bytesUsed = s.count * (type().size + sizeof(EntityId))
+                + slots * sizeof(std::size_t);
+            s.bytesReserved = _resource.bytes();
+            s.sparseFill = slots ? static_cast<double>(s.count) / slots : 0;
+            return s;
+        }
+
+        /**
+         * @brief Renumber the owners of the components and release the unused
+         *        capacity of the pool
+         * @param remap The new id of each old entity id
+         */
+        inline void compact(const std::vector<EntityId>& remap) override
+        {
+            _sparse.clear();
+            for (std::size_t i = 0; i < _owners.size(); i++) {
+                _owners[i] = remap[_owners[i]];
+                _sparse.at(_owners[i]) = i + 1;
+            }
+            _dense.shrink_to_fit();
+            _owners.shrink_to_fit();
+        }
+
+        /**
+         * @brief Copy the content of the pool in the given image
+         *        (the image is created if missing or of another type)
+         * @param image The image to write to
+         */
+        inline void save(std::unique_ptr<IPoolImage>& image) const override
+        {
+            auto* out = dynamic_cast<RawPoolImage*>(image.get());
+            if (out == nullptr || out->data.type().name != type().name) {
+                image = std::make_unique<RawPoolImage>(type());
+                out = static_cast<RawPoolImage*>(image.get());
+            }
+            out->type = hash();
+            out->stride = stride();
+            out->owners.assign(_owners.begin(), _owners.end());
+            out->data.assign(_dense.data(), _dense.size());
+            if (type().trivial()) {
+                const std::size_t page = SILVA_HASH_PAGE_SIZE * type().size;
+                const std::size_t size = _dense.size() * type().size;
+                out->pages.resize((size + page - 1) / page);
+                for (std::size_t i = 0; i < out->pages.size(); i++)
+                    out->pages[i] = hashBytes(out->raw() + i * page, std::min(page, size - i * page));
+            } else {
+                out->pages.clear();
+            }
+        }
+
+        /**
+         * @brief Tells if the pool can be restored from the given image
+         * @param image The image to check
+         * @return true restore() accepts the image
+         * @return false restore() would throw
+         */
+        inline bool accepts(const IPoolImage& image) const override
+        {
+            const auto* in = dynamic_cast<const RawPoolImage*>(&image);
+            return in != nullptr && in->data.type().name == type().name;
+        }
+
+        /**
+         * @brief Replace the content of the pool by the given image
+         * @param image The image to read from
+         */
+        inline void restore(const IPoolImage& image) override
+        {
+            const auto* in = dynamic_cast<const RawPoolImage*>(&image);
+            if (accepts(image) == false)
+                throw Error("restore(): the image does not match the pool of " + type().name);
+            clear();
+            _owners.assign(in->owners.begin(), in->owners.end());
+            _dense.assign(in->data.data(), in->data.size());
+            for (std::size_t i = 0; i < _owners.size(); i++)
+                _sparse.at(_owners[i]) = i + 1;
+        }
+
+        /**
+         * @brief Remove every component of the pool
+         */
+        inline void clear() override
+        {
+            for (const auto& e : _owners)
+                *_sparse.find(e) = 0;
+            _owners.clear();
+            _dense.clear();
+        }
+
+        /**
+         * @brief Get the hash of the name of the component type
+         * @return std::uint64_t The hash
+         */
+        inline std::uint64_t hash() const override { return typeHash(type().name.c_str()); }
+
+        /**
+         * @brief Get the size of a component if it can be copied as raw bytes
+         * @return std::size_t The size of a component or 0 if it can not
+         */
+        inline std::size_t stride() const override { return type().trivial() ? type().size : 0; }
+
+        /**
+         * @brief Get the entities owning the components
+         * @return const EntityId* The entities (size() of them)
+         */
+        inline const EntityId* owners() const override { return _owners.data(); }
+
+        /**
+         * @brief Get the components as raw bytes
+         * @return const void* The components (size() * stride() bytes)
+         */
+        inline const void* raw() const override { return _dense.data(); }
+
+        /**
+         * @brief Replace the content of the pool by raw components
+         *        (only for pools with a stride)
+         * @param owners The entity owning each component
+         * @param data The components (n * stride() bytes)
+         * @param n The number of components
+         */
+        inline void load(const EntityId* owners, const void* data, const std::size_t& n) override
+        {
+            if (type().trivial() == false)
+                throw Error("load(): " + type().name + " can not be loaded from raw bytes");
+            clear();
+            _owners.assign(owners, owners + n);
+            _dense.assign(data, n);
+            for (std::size_t i = 0; i < n; i++)
+                _sparse.at(_owners[i]) = i + 1;
+        }
+
+        /**
+         * @brief Set the component of the given entity from a copy of the
+         *        given one (raw bytes for pools with a stride)
+         * @param e The entity
+         * @param data The component
+         * @return true The entity did not have the component before
+         * @return false The component of the entity was overwritten
+         */
+        inline bool assign(const EntityId& e, const void* data) override
+        {
+            std::size_t& slot = _sparse.at(e);
+            if (slot != 0) {
+                _dense.set(slot - 1, data);
+                return false;
+            }
+            _dense.push_back(data);
+            _owners.push_back(e);
+            slot = _dense.size();
+            return true;
+        }
+
+        /**
+         * @brief Get the component of the given entity if it has one
+         * @param e The entity
+         * @return void* The component (nullptr if the entity has none)
+         */
+        inline void* find(const EntityId& e) override
+        {
+            const std::size_t* slot = _sparse.find(e);
+            return slot == nullptr || *slot == 0 ? nullptr : _dense[*slot - 1];
+        }
+
+        /**
+         * @brief Get the component of the given entity if it has one
+         * @param e The entity
+         * @return const void* The component (nullptr if the entity has none)
+         */
+        inline const void* find(const EntityId& e) const override
+        {
+            const std::size_t* slot = _sparse.find(e);
+            return slot == nullptr || *slot == 0 ? nullptr : _dense[*slot - 1];
+        }
+
+        /**
+         * @brief Create an empty pool of the same component type
+         * @param upstream The resource the memory of the pool comes from
+         * @return std::unique_ptr<IPool> The new pool
+         */
+        inline std::unique_ptr<IPool> create(std::pmr::memory_resource* upstream) const override
+        {
+            return std::make_unique<RawPool>(type(), upstream);
+        }
+
+        /**
+         * @brief Move the component of the given entity to a pool of the same
+         *        type (of another registry), then remove it from this pool
+         * @param e The entity owning the component
+         * @param dst The pool to move the component to
+         * @param to The entity receiving the component in dst
+         * @return true The component was moved
+         * @return false The entity does not have the component
+         */
+        inline bool moveTo(const EntityId& e, IPool& dst, const EntityId& to) override
+        {
+            const void* value = find(e);
+            if (value == nullptr)
+                return false;
+            dst.assign(to, value);
+            remove(e);
+            return true;
+        }
+
+        /**
+         * @brief Reserve room for the given number of components
+         * @param n The number of components
+         */
+        inline void reserve(const std::size_t& n)
+        {
+            _dense.reserve(n);
+            _owners.reserve(n);
+        }
+    };
+
+    /**
+     * @brief The calls made on a component during the current frame
+     */
+    struct AccessCounts {
+        /**
+         * @brief The number of calls to get and try_get
+         */
+        std::size_t get = 0;
+
+        /**
+         * @brief The number of calls to has
+         */
+        std::size_t has = 0;
+
+        /**
+         * @brief The number of calls to emplace
+         */
+        std::size_t emplace = 0;
+
+        /**
+         * @brief The number of views built on the component
+         */
+        std::size_t views = 0;
+    };
+
+    /**
+     * @brief A system is a collection of entities
+     *       that are updated at a certain interval
+     *       The system requires a function to update
+     *       the entities
+     *       To make sure the entities are matching the system
+     *       we use dependencies and make them match with the entities
+     *       Dependencies are the components that the system requires
+     */
+    class System {
+    private:
+        /**
+         * @brief The entities that are part of the system
+         */
+        std::pmr::vector<Entity> _entities;
+
+        /**
+         * @brief Tells which entities are part of the system
+         */
+        PagedArray<bool> _members;
+
+        /**
+         * @brief The updater function of the system
+         */
+        SystemUpdater _f;
+
+        /**
+         * @brief The dependencies of the system
+         */
+        std::vector<ComponentIndex> _dependencies;
+
+        /**
+         * @brief The index of the next entity to update
+         *        in case we want to remove some while iterating
+         *        It is only kept between two updates when a pass runs out
+         *        of budget, to resume it
+         */
+        std::size_t _index = 0;
+
+        /**
+         * @brief When the system runs
+         */
+        RunPolicy _policy;
+
+        /**
+         * @brief The number of updates since the last pass started
+         */
+        std::size_t _frames = 0;
+
+        /**
+         * @brief The time taken by the last update
+         */
+        std::chrono::nanoseconds _lastUpdate = std::chrono::nanoseconds::zero();
+
+        /**
+         * @brief The number of entities updated by the last update
+         */
+        std::size_t _lastUpdated = 0;
+
+        /**
+         * @brief The stage the system runs in
+         */
+        Stage _stage;
+
+#if SILVA_COUNTERS
+        /**
+         * @brief The calls made by the system during the current frame
+         *        (per ComponentIndex)
+         */
+        std::vector<AccessCounts> _counts;
+#endif
+
+        /**
+         * @brief Remove a member from the entities of the system, keeping
+         *        _index on the next entity to update (an entity removed
+         *        during a pass, or between two slices of it, must not make
+         *        the pass skip the following one)
+         * @param e The entity to remove (must be a member)
+         */
+        inline void _erase(const Entity& e)
+        {
+            _members.reset(e.id);
+            const auto it = std::find(_entities.begin(), _entities.end(), e);
+            if (static_cast<std::size_t>(it - _entities.begin()) < _index)
+                _index--;
+            _entities.erase(it);
+        }
+
+    public:
+        /**
+         * @brief Construct a new System
+         * @param stage The stage the system runs in
+         * @param resource The resource the entity list is allocated from
+         */
+        inline System(const Stage& stage = Stage::Update,
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : _entities(resource)
+            , _members(resource)
+            , _stage(stage)
+        {
+        }
+
+        /**
+         * @brief Get the stage the system runs in
+         * @return const Stage& The stage
+         */
+        inline const Stage& stage() const { return _stage; }
+
+        /**
+         * @brief Tells if the given entity is part of the system
+         * @param e The entity to check
+         * @return true The entity is part of the system
+         * @return false The entity is not part of the system
+         */
+        inline bool isMember(const Entity& e) const
+        {
+            const bool* member = _members.find(e.id);
+            return member != nullptr && *member;
+        }
+
+        /**
+         * @brief Set the System Update object
+         * @param f The function to update the system
+         */
+        inline void setSystemUpdate(const SystemUpdater& f) { _f = f; }
+
+        /**
+         * @brief Set the run policy of the system
+         * @param policy When the system runs
+         */
+        inline void setPolicy(const RunPolicy& policy)
+        {
+            _policy = policy;
+            _policy.every = std::max<std::size_t>(_policy.every, 1);
+            _frames = 0;
+        }
+
+        /**
+         * @brief Get the run policy of the system
+         * @return const RunPolicy& When the system runs
+         */
+        inline const RunPolicy& policy() const { return _policy; }
+
+        /**
+         * @brief Get the System Update object (uses indexes)
+         * @param dependency The dependency of the system
+         */
+        inline void addDependency(const ComponentIndex& dependency)
+        {
+            if (std::find(
+                    _dependencies.begin(), _dependencies.end(), dependency)
+                != _dependencies.end())
+                return;
+            _dependencies.push_back(dependency);
+        }
+
+        /**
+         * @brief tries to see if the given entity should be part of the system
+         *        If the entity has all the dependencies of the system and is
+         * not already part of the system the entity is added to the system If
+         * the entity is already part of the system and has not all the
+         * dependencies the entity is removed from the system. Otherwise it does
+         * nothing
+         * @param r The registry
+         * @param e The entity to check
+         */
+        inline void onEntityUpdate(registry& r, const Entity& e);
+
+        /**
+         * @brief Adds the given new entities to the system if they match it
+         *        (they all have the same components so only the first one is
+         * checked)
+         * @param r The registry
+         * @param es The new entities
+         */
+        inline void onEntitiesCreate(registry& r, const std::vector<Entity>& es);
+
+        /**
+         * @brief Remove the given entity from the system
+         * @param e The entity to remove
+         */
+        inline void onEntityDelete(const Entity& e)
+        {
+            if (isMember(e) == false)
+                return;
+            _erase(e);
+        }
+
+        /**
+         * @brief Update the system
+         * @param r The registry to use
+         */
+        inline void update(registry& r)
+        {
+            const auto start = std::chrono::steady_clock::now();
+
+            _lastUpdate = std::chrono::nanoseconds::zero();
+            _lastUpdated = 0;
+            if (++_frames < _policy.every && _index == 0)
+                return;
+            if (_policy.condition && _policy.condition(r) == false)
+                return;
+            if (_index == 0)
+                _frames = 0;
+            while (_index < _entities.size()) {
+                const Entity e = _entities[_index++];
+                _f(e, r);
+                _lastUpdated++;
+                if (_policy.budget.count() != 0
+                    && std::chrono::steady_clock::now() - start >= _policy.budget)
+                    break;
+            }
+            if (_index >= _entities.size())
+                _index = 0;
+            _lastUpdate = std::chrono::steady_clock::now() - start;
+        }
+
+        /**
+         * @brief Get the number of entities matching the system
+         * @return std::size_t The number of entities
+         */
+        inline std::size_t size() const { return _entities.size(); }
+
+        /**
+         * @brief Get the dependencies of the system
+         * @return const std::vector<ComponentIndex>& The dependencies
+         */
+        inline const std::vector<ComponentIndex>& dependencies() const { return _dependencies; }
+
+        /**
+         * @brief Copy the entities of the system
+         * @param out The list to write to
+         */
+        inline void save(std::vector<Entity>& out) const
+        {
+            out.assign(_entities.begin(), _entities.end());
+        }
+
+        /**
+         * @brief Replace the entities of the system
+         * @param in The list to read from
+         */
+        inline void load(const std::vector<Entity>& in)
+        {
+            _index = 0;
+            if (std::equal(_entities.begin(), _entities.end(), in.begin(), in.end()))
+                return;
+            for (const auto& e : _entities)
+                _members.reset(e.id);
+            _entities.assign(in.begin(), in.end());
+            for (const auto& e : _entities)
+                _members.at(e.id) = true;
+        }
+
+        /**
+         * @brief Remove every entity from the system
+         */
+        inline void clear() { load({}); }
+
+        /**
+         * @brief Renumber the entities of the system
+         * @param remap The new id of each old entity id
+         */
+        inline void compact(const std::vector<EntityId>& remap)
+        {
+            _members.clear();
+            for (auto& e : _entities) {
+                e.id = remap[e.id];
+                _members.at(e.id) = true;
+            }
+            _entities.shrink_to_fit();
+        }
+
+        /**
+         * @brief Get the time taken by the last update
+         * @return const std::chrono::nanoseconds& The duration of the last update
+         */
+        inline const std::chrono::nanoseconds& lastUpdate() const { return _lastUpdate; }
+
+        /**
+         * @brief Get the number of entities updated by the last update
+         * @return const std::size_t& The number of entities
+         */
+        inline const std::size_t& lastUpdated() const { return _lastUpdated; }
+
+#if SILVA_COUNTERS
+        /**
+         * @brief Get the calls made by the system during the current frame
+         * @return std::vector<AccessCounts>& The calls (per ComponentIndex)
+         */
+        inline std::vector<AccessCounts>& counts() { return _counts; }
+#endif
+    };
+
+}
+
+namespace priv {
+
+    /**
+     * @brief Type erased component of a Prefab
+     */
+    class IPrefabComponent {
+    public:
+        virtual ~IPrefabComponent() = default;
+
+        /**
+         * @brief Copy the component in the pool of the registry for every
+         *        given entity
+         * @param r The registry
+         * @param es The new entities
+         */
+        virtual void spawn(registry& r, const std::vector<Entity>& es) const = 0;
+    };
+
+    /**
+     * @brief Default value of a component of a Prefab
+     * @tparam T The type of the component
+     */
+    template <typename T>
+    class PrefabComponent : public IPrefabComponent {
+    private:
+        /**
+         * @brief The value copied in each new entity
+         */
+        T _value;
+
+    public:
+        /**
+         * @brief Construct a new Prefab Component
+         * @param value The value copied in each new entity
+         */
+        inline PrefabComponent(T&& value)
+            : _value(std::move(value))
+        {
+        }
+
+        /**
+         * @brief Copy the component in the pool of the registry for every
+         *        given entity
+         * @param r The registry
+         * @param es The new entities
+         */
+        inline void spawn(registry& r, const std::vector<Entity>& es) const override;
+    };
+
+}
+
+/**
+ * @brief A Prefab is a set of components with default values
+ *        It is used to create many entities at once with registry::instantiate
+ */
+class Prefab {
+private:
+    /**
+     * @brief The components of the prefab (one per type)
+     */
+    std::unordered_map<TypeNameId, std::shared_ptr<priv::IPrefabComponent>> _components;
+
+public:
+    /**
+     * @brief Set the default value of the given component
+     * @tparam T The type of the component
+     * @tparam Args... The types of the arguments
+     * @param args The arguments used to build the component
+     * @return Prefab& The prefab to chain the calls
+     */
+    template <typename T, typename... Args>
+    inline Prefab& set(Args&&... args)
+    {
+        _components[typeid(T).name()] = std::make_shared<priv::PrefabComponent<T>>(
+            T { std::forward<Args>(args)... });
+        return *this;
+    }
+
+    /**
+     * @brief Remove the given component from the prefab
+     * @tparam T The type of the component
+     * @return Prefab& The prefab to chain the calls
+     */
+    template <typename T>
+    inline Prefab& unset()
+    {
+        _components.erase(typeid(T).name());
+        return *this;
+    }
+
+    /**
+     * @brief Get the components of the prefab
+     * @return const std::unordered_map<TypeNameId, std::shared_ptr<priv::IPrefabComponent>>& The components
+     */
+    inline const std::unordered_map<TypeNameId, std::shared_ptr<priv::IPrefabComponent>>&
+    components() const
+    {
+        return _components;
+    }
+};
+
+/**
+ * @brief A Snapshot holds a copy of every pool, system membership and the
+ *        entity allocator of a registry (see registry::snapshot)
+ *        Capturing again in the same Snapshot reuses its buffers
+ */
+class Snapshot {
+private:
+    /**
+     * @brief The registry reads and writes the snapshot directly
+     */
+    friend class registry;
+
+    /**
+     * @brief diff compares the snapshots directly
+     */
+    friend Delta diff(const Snapshot& prev, const Snapshot& cur);
+
+    /**
+     * @brief The next entity id
+     */
+    EntityId _lastEntityId = 0;
+
+    /**
+     * @brief The free entity ids
+     */
+    priv::IdHeap _removedEntitiesIds;
+
+    /**
+     * @brief The last used entity
+     */
+    EntityId _lastUsedEntity = 0;
+
+    /**
+     * @brief The content of each pool (uses ComponentIndex)
+     */
+    std::vector<std::unique_ptr<priv::IPoolImage>> _pools;
+
+    /**
+     * @brief The entities of each system (uses tags)
+     */
+    std::unordered_map<std::string, std::vector<Entity>> _systems;
+
+    /**
+     * @brief The hierarchy as (entity, parent) pairs in depth-first order
+     */
+    std::vector<std::pair<Entity, Entity>> _hierarchy;
+
+public:
+    /**
+     * @brief Get the number of bytes held by the snapshot
+     * @return std::size_t The number of bytes
+     */
+    inline std::size_t bytes() const
+    {
+        std::size_t n = _removedEntitiesIds.size() * sizeof(EntityId);
+        for (const auto& pool : _pools)
+            n += pool->bytes();
+        for (const auto& sys : _systems)
+            n += sys.second.size() * sizeof(Entity);
+        n += _hierarchy.size() * sizeof(std::pair<Entity, Entity>);
+        return n;
+    }
+};
+
+/**
+ * @brief A Delta holds the changes between two snapshots of a registry:
+ *        created and destroyed entities and the components that were added,
+ *        changed or removed (see silva::diff and registry::apply)
+ *        Only the components that can be copied as raw bytes are tracked
+ */
+class Delta {
+private:
+    /**
+     * @brief The changes of a single pool
+     */
+    struct PoolDelta {
+        /**
+         * @brief The hash of the name of the component type
+         */
+        std::uint64_t type = 0;
+
+        /**
+         * @brief The size of a component
+         */
+        std::uint64_t stride = 0;
+
+        /**
+         * @brief The entities that lost the component
+         */
+        std::vector<EntityId> removed;
+
+        /**
+         * @brief The entities whose component was added or changed
+         */
+        std::vector<EntityId> changed;
+
+        /**
+         * @brief The new value of each changed component
+         */
+        std::vector<unsigned char> data;
+    };
+
+    /**
+     * @brief diff fills the delta directly
+     */
+    friend Delta diff(const Snapshot& prev, const Snapshot& cur);
+
+    /**
+     * @brief The registry reads the delta directly
+     */
+    friend class registry;
+
+    /**
+     * @brief The next entity id after the changes
+     */
+    EntityId _lastEntityId = 0;
+
+    /**
+     * @brief The free entity ids after the changes
+     */
+    std::vector<EntityId> _freeIds;
+
+    /**
+     * @brief The created entities
+     */
+    std::vector<EntityId> _created;
+
+    /**
+     * @brief The destroyed entities
+     */
+    std::vector<EntityId> _destroyed;
+
+    /**
+     * @brief The changes of each pool that changed
+     */
+    std::vector<PoolDelta> _pools;
+
+    /**
+     * @brief Write a vector in a stream (size then content)
+     * @param os The stream
+     * @param v The vector
+     */
+    template <typename T>
+    static inline void _write(std::ostream& os, const std::vector<T>& v)
+    {
+        const std::uint64_t size = v.size();
+        os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        os.write(reinterpret_cast<const char*>(v.data()), size * sizeof(T));
+    }
+
+    /**
+     * @brief Read a vector written by _write from a stream
+     * @param is The stream
+     * @param v The vector
+     */
+    template <typename T>
+    static inline void _read(std::istream& is, std::vector<T>& v)
+    {
+        // read by chunks so a corrupt size on a stream that cannot tell its
+        // length does not allocate more than what the stream really holds
+        static constexpr std::uint64_t chunk = (std::uint64_t(1) << 16) / sizeof(T) + 1;
+        std::uint64_t size = 0;
+
+        is.read(reinterpret_cast<char*>(&size), sizeof(size));
+        if (!is || size > _remaining(is) / sizeof(T))
+            throw Error("Delta::read(): corrupted delta");
+        v.clear();
+        for (std::uint64_t done = 0; done < size;) {
+            const std::uint64_t n = std::min(size - done, chunk);
+            v.resize(done + n);
+            is.read(reinterpret_cast<char*>(v.data() + done), n * sizeof(T));
+            if (!is)
+                throw Error("Delta::read(): corrupted delta");
+            done += n;
+        }
+    }
+
+    /**
+     * @brief Get the number of bytes left in a stream
+     * @param is The stream
+     * @return std::uint64_t The number of bytes left (the maximum value if
+     *         the stream cannot seek)
+     */
+    static inline std::uint64_t _remaining(std::istream& is)
+    {
+        const std::istream::pos_type pos = is.tellg();
+        if (pos == std::istream::pos_type(-1))
+            return std::numeric_limits<std::uint64_t>::max();
+        is.seekg(0, std::ios::end);
+        const std::istream::pos_type end = is.tellg();
+        is.seekg(pos);
+        if (!is || end == std::istream::pos_type(-1) || end < pos)
+            throw Error("Delta::read(): corrupted delta");
+        return static_cast<std::uint64_t>(end - pos);
+    }
+
+public:
+    /**
+     * @brief Get the created entities
+     * @return const std::vector<EntityId>& The created entities
+     */
+    inline const std::vector<EntityId>& created() const { return _created; }
+
+    /**
+     * @brief Get the destroyed entities
+     * @return const std::vector<EntityId>& The destroyed entities
+     */
+    inline const std::vector<EntityId>& destroyed() const { return _destroyed; }
+
+    /**
+     * @brief Get the number of added, changed or removed components
+     * @return std::size_t The number of component changes
+     */
+    inline std::size_t changes() const
+    {
+        std::size_t n = 0;
+        for (const auto& pool : _pools)
+            n += pool.removed.size() + pool.changed.size();
+        return n;
+    }
+
+    /**
+     * @brief Get the size of the delta once written
+     * @return std::size_t The number of bytes
+     */
+    inline std::size_t bytes() const
+    {
+        std::size_t n = sizeof(std::uint64_t) * 5
+            + (_freeIds.size() + _created.size() + _destroyed.size()) * sizeof(EntityId);
+        for (const auto& pool : _pools)
+            n += sizeof(std::uint64_t) * 5
+                + (pool.removed.size() + pool.changed.size()) * sizeof(EntityId)
+                + pool.data.size();
+        return n;
+    }
+
+    /**
+     * @brief Write the delta in a binary stream (for replays or the network)
+     * @param os The stream
+     */
+    inline void write(std::ostream& os) const
+    {
+        const std::uint64_t header[2] = { _lastEntityId, _pools.size() };
+        os.write(reinterpret_cast<const char*>(header), sizeof(header));
+        _write(os, _freeIds);
+        _write(os, _created);
+        _write(os, _destroyed);
+        for (const auto& pool : _pools) {
+            const std::uint64_t info[2] = { pool.type, pool.stride };
+            os.write(reinterpret_cast<const char*>(info), sizeof(info));
+            _write(os, pool.removed);
+            _write(os, pool.changed);
+            _write(os, pool.data);
+        }
+    }
+
+    /**
+     * @brief Read a delta written by write() from a binary stream
+     * @param is The stream
+     * @return Delta The delta
+     */
+    static inline Delta read(std::istream& is)
+    {
+        Delta d;
+        std::uint64_t header[2] = { 0, 0 };
+        is.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!is)
+            throw Error("Delta::read(): corrupted delta");
+        const auto valid = [&header](const std::vector<EntityId>& ids) {
+            for (const auto& id : ids)
+                if (id >= header[0])
+                    throw Error("Delta::read(): corrupted delta (entity " + std::to_string(id) + ")");
+        };
+        d._lastEntityId = header[0];
+        _read(is, d._freeIds);
+        _read(is, d._created);
+        _read(is, d._destroyed);
+        valid(d._freeIds);
+        valid(d._created);
+        valid(d._destroyed);
+        for (std::uint64_t i = 0; i < header[1]; i++) {
+            PoolDelta pool;
+            std::uint64_t info[2] = { 0, 0 };
+            is.read(reinterpret_cast<char*>(info), sizeof(info));
+            if (!is || info[1] == 0)
+                throw Error("Delta::read(): corrupted delta");
+            pool.type = info[0];
+            pool.stride = info[1];
+            _read(is, pool.removed);
+            _read(is, pool.changed);
+            _read(is, pool.data);
+            if (pool.data.size() % pool.stride != 0 || pool.data.size() / pool.stride != pool.changed.size())
+                throw Error("Delta::read(): corrupted delta");
+            valid(pool.removed);
+            valid(pool.changed);
+            d._pools.push_back(std::move(pool));
+        }
+        return d;
+    }
+};
+
+/**
+ * @brief Computes the changes needed to go from one snapshot to another
+ *        (both taken from the same registry)
+ *        Pools keeping the same entities in the same order only compare
+ *        the pages whose hash changed, the others are compared per entity
+ * @param prev The older snapshot
+ * @param cur The newer snapshot
+ * @return Delta The changes from prev to cur
+ */
+inline Delta diff(const Snapshot& prev, const Snapshot& cur)
+{
+    Delta d;
+    const auto alive = [](const Snapshot& s) {
+        std::vector<bool> a(s._lastEntityId, true);
+        for (const auto& id : s._removedEntitiesIds.ids())
+            a[id] = false;
+        return a;
+    };
+    const std::vector<bool> before = alive(prev);
+    const std::vector<bool> after = alive(cur);
+
+    for (EntityId id = 0; id < std::max(before.size(), after.size()); id++) {
+        const bool was = id < before.size() && before[id];
+        const bool is = id < after.size() && after[id];
+        if (is && was == false)
+            d._created.push_back(id);
+        else if (was && is == false)
+            d._destroyed.push_back(id);
+    }
+    d._lastEntityId = cur._lastEntityId;
+    d._freeIds = cur._removedEntitiesIds.ids();
+
+    for (std::size_t i = 0; i < std::max(prev._pools.size(), cur._pools.size()); i++) {
+        const priv::IPoolImage* p = i < prev._pools.size() ? prev._pools[i].get() : nullptr;
+        const priv::IPoolImage* c = i < cur._pools.size() ? cur._pools[i].get() : nullptr;
+        if (c == nullptr || c->stride == 0 || (p && p->type != c->type))
+            continue;
+
+        Delta::PoolDelta pool;
+        const std::size_t stride = c->stride;
+        const auto change = [&pool, &c, &stride](const std::size_t& j) {
+            pool.changed.push_back(c->owners[j]);
+            pool.data.insert(pool.data.end(), c->raw() + j * stride, c->raw() + (j + 1) * stride);
+        };
+        pool.type = c->type;
+        pool.stride = stride;
+
+        if (p == nullptr) {
+            for (std::size_t j = 0; j < c->owners.size(); j++)
+                change(j);
+        } else if (p->owners == c->owners) {
+            for (std::size_t k = 0; k < c->pages.size(); k++) {
+                if (k < p->pages.size() && p->pages[k] == c->pages[k])
+                    continue;
+                const std::size_t end = std::min((k + 1) * SILVA_HASH_PAGE_SIZE, c->owners.size());
+                for (std::size_t j = k * SILVA_HASH_PAGE_SIZE; j < end; j++)
+                    if (std::memcmp(p->raw() + j * stride, c->raw() + j * stride, stride) != 0)
+                        change(j);
+            }
+        } else {
+            priv::PagedArray<std::size_t> slots;
+            for (std::size_t j = 0; j < p->owners.size(); j++)
+                slots.at(p->owners[j]) = j + 1;
+            for (std::size_t j = 0; j < c->owners.size(); j++) {
+                std::size_t* slot = slots.find(c->owners[j]);
+                if (slot == nullptr || *slot == 0
+                    || std::memcmp(p->raw() + (*slot - 1) * stride, c->raw() + j * stride, stride) != 0)
+                    change(j);
+                if (slot != nullptr)
+                    *slot = 0;
+            }
+            for (const auto& e : p->owners) {
+                const std::size_t* slot = slots.find(e);
+                if (*slot != 0 && e < after.size() && after[e])
+                    pool.removed.push_back(e);
+            }
+        }
+        if (pool.changed.empty() == false || pool.removed.empty() == false)
+            d._pools.push_back(std::move(pool));
+    }
+    return d;
+}
+
+/**
+ * @brief Parent / child relationships between entities
+ *        The nodes are kept sorted depth-first in a flat array (each node is
+ *        followed by its whole subtree) so propagating something from the
+ *        parents to the children is a single linear pass, and only the
+ *        subtrees below a dirty node are visited by the callback
+ */
+class Hierarchy {
+private:
+    /**
+     * @brief A node of the hierarchy
+     */
+    struct Node {
+        /**
+         * @brief The entity of the node
+         */
+        Entity entity;
+
+        /**
+         * @brief The parent of the node (InvalidEntityId for a root)
+         */
+        Entity parent;
+
+        /**
+         * @brief The depth of the node (0 for a root)
+         */
+        std::uint32_t depth;
+
+        /**
+         * @brief The number of nodes in the subtree (the node included)
+         */
+        std::uint32_t size;
+
+        /**
+         * @brief Tells if the node changed since the last propagation
+         */
+        bool dirty;
+    };
+
+    /**
+     * @brief The nodes in depth-first order
+     */
+    std::pmr::vector<Node> _nodes;
+
+    /**
+     * @brief The index + 1 of the node of each entity (0 when not in the hierarchy)
+     */
+    priv::PagedArray<std::size_t> _slots;
+
+    /**
+     * @brief Get the index of the node of the given entity
+     * @param e The entity
+     * @return std::size_t The index (_nodes.size() if not in the hierarchy)
+     */
+    inline std::size_t _find(const Entity& e) const
+    {
+        const std::size_t* slot = _slots.find(e.id);
+        return slot == nullptr || *slot == 0 ? _nodes.size() : *slot - 1;
+    }
+
+    /**
+     * @brief Get the index of the node of the given entity, adding it as a
+     *        root if needed
+     * @param e The entity
+     * @return std::size_t The index of the node
+     */
+    inline std::size_t _node(const Entity& e)
+    {
+        std::size_t& slot = _slots.at(e.id);
+        if (slot == 0) {
+            _nodes.push_back(Node { e, Entity(InvalidEntityId), 0, 1, true });
+            slot = _nodes.size();
+        }
+        return slot - 1;
+    }
+
+    /**
+     * @brief Add the given count to the subtree size of the ancestors
+     * @param parent The first ancestor
+     * @param count The count to add (can wrap to remove)
+     */
+    inline void _grow(Entity parent, const std::uint32_t& count)
+    {
+        while (parent.id != InvalidEntityId) {
+            Node& node = _nodes[_find(parent)];
+            node.size += count;
+            parent = node.parent;
+        }
+    }
+
+    /**
+     * @brief Moves the subtree at the given index right before the given
+     *        position and fixes the slots of the moved nodes
+     * @param from The index of the root of the subtree
+     * @param to The position to move it to (outside of the subtree)
+     * @return std::size_t The new index of the root of the subtree
+     */
+    inline std::size_t _move(const std::size_t& from, const std::size_t& to)
+    {
+        const std::size_t size = _nodes[from].size;
+        std::size_t first = from;
+        std::size_t last = to;
+        std::size_t moved = to - size;
+
+        if (to == from || to == from + size)
+            return from;
+        if (to < from) {
+            std::rotate(_nodes.begin() + to, _nodes.begin() + from, _nodes.begin() + from + size);
+            first = to;
+            last = from + size;
+            moved = to;
+        } else
+            std::rotate(_nodes.begin() + from, _nodes.begin() + from + size, _nodes.begin() + to);
+        for (std::size_t i = first; i < last; i++)
+            _slots.at(_nodes[i].entity.id) = i + 1;
+        return moved;
+    }
+
+public:
+    /**
+     * @brief Construct a new empty Hierarchy
+     * @param resource The resource the nodes are allocated from
+     */
+    inline Hierarchy(
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : _nodes(resource)
+        , _slots(resource)
+    {
+    }
+
+    /**
+     * @brief Tells if the given entity is in the hierarchy
+     * @param e The entity
+     * @return true The entity is in the hierarchy
+     * @return false The entity is not in the hierarchy
+     */
+    inline bool has(const Entity& e) const { return _find(e) != _nodes.size(); }
+
+    /**
+     * @brief Adds the given entity as a root (does nothing if it is already
+     *        in the hierarchy)
+     * @param e The entity
+     * @return Hierarchy& The hierarchy to chain the calls
+     */
+    inline Hierarchy& add(const Entity& e)
+    {
+        _node(e);
+        return *this;
+    }
+
+    /**
+     * @brief Makes the given entity (and its subtree) a child of the given
+     *        parent, both are added to the hierarchy if needed
+     *        Passing Entity(InvalidEntityId) as parent makes it a root
+     * @param child The child
+     * @param parent The new parent
+     * @return Hierarchy& The hierarchy to chain the calls
+     */
+    inline Hierarchy& attach(const Entity& child, const Entity& parent)
+    {
+        std::size_t c = _node(child);
+        const Node old = _nodes[c];
+
+        if (old.parent == parent)
+            return *this;
+        if (parent.id != InvalidEntityId) {
+            const std::size_t p = _node(parent);
+            if (p >= c && p < c + old.size)
+                throw Error("attach(): " + std::to_string(parent.id)
+                    + " is in the subtree of " + std::to_string(child.id));
+        }
+        const std::size_t p = _find(parent);
+        const std::size_t to = p == _nodes.size() ? p : p + _nodes[p].size;
+        _grow(old.parent, -old.size);
+        c = _move(c, to);
+        const std::uint32_t depth = parent.id == InvalidEntityId ? 0 : _nodes[_find(parent)].depth + 1;
+        for (std::size_t i = c; i < c + old.size; i++)
+            _nodes[i].depth = _nodes[i].depth - old.depth + depth;
+        _nodes[c].parent = parent;
+        _nodes[c].dirty = true;
+        _grow(parent, old.size);
+        return *this;
+    }
+
+    /**
+     * @brief Makes the given entity (and its subtree) a root
+     * @param e The entity
+     * @return Hierarchy& The hierarchy to chain the calls
+     */
+    inline Hierarchy& detach(const Entity& e) { return attach(e, Entity(InvalidEntityId)); }
+
+    /**
+     * @brief Removes the given entity from the hierarchy, its children
+     *        become roots
+     * @param e The entity
+     * @return Hierarchy& The hierarchy to chain the calls
+     */
+    inline Hierarchy& remove(const Entity& e)
+    {
+        if (has(e) == false)
+            return *this;
+        for (const auto& child : children(e))
+            detach(child);
+        const std::size_t i = _find(e);
+        _grow(_nodes[i].parent, -1);
+        _move(i, _nodes.size());
+        _slots.reset(e.id);
+        _nodes.pop_back();
+        return *this;
+    }
+
+    /**
+     * @brief Get the parent of the given entity
+     * @param e The entity
+     * @return Entity The parent (Entity(InvalidEntityId) for a root or an
+     *         entity outside of the hierarchy)
+     */
+    inline Entity parent(const Entity& e) const
+    {
+        const std::size_t i = _find(e);
+        return i == _nodes.size() ? Entity(InvalidEntityId) : _nodes[i].parent;
+    }
+
+    /**
+     * @brief Get the direct children of the given entity
+     * @param e The entity
+     * @return std::vector<Entity> The children in depth-first order
+     */
+    inline std::vector<Entity> children(const Entity& e) const
+    {
+        std::vector<Entity> out;
+        const std::size_t i = _find(e);
+
+        if (i == _nodes.size())
+            return out;
+        for (std::size_t j = i + 1; j < i + _nodes[i].size; j += _nodes[j].size)
+            out.push_back(_nodes[j].entity);
+        return out;
+    }
+
+    /**
+     * @brief Get the depth of the given entity (0 for a root)
+     * @param e The entity
+     * @return std::size_t The depth
+     */
+    inline std::size_t depth(const Entity& e) const
+    {
+        const std::size_t i = _find(e);
+        return i == _nodes.size() ? 0 : _nodes[i].depth;
+    }
+
+    /**
+     * @brief Get the number of entities in the hierarchy
+     * @return std::size_t The number of entities
+     */
+    inline std::size_t size() const { return _nodes.size(); }
+
+    /**
+     * @brief Flags the given entity as changed, its subtree will be visited
+     *        by the next propagation (does nothing if the entity is not in
+     *        the hierarchy)
+     * @param e The entity
+     * @return Hierarchy& The hierarchy to chain the calls
+     */
+    inline Hierarchy& markDirty(const Entity& e)
+    {
+        const std::size_t i = _find(e);
+        if (i != _nodes.size())
+            _nodes[i].dirty = true;
+        return *this;
+    }
+
+    /**
+     * @brief Calls f(entity, parent) for every dirty entity and every entity
+     *        below a dirty one, parents always before their children, then
+     *        clears the dirty flags (parent is Entity(InvalidEntityId) for
+     *        the roots)
+     * @param f The function to call
+     * @tparam F The type of the function
+     */
+    template <typename F>
+    inline void propagate(const F& f)
+    {
+        std::size_t i = 0;
+
+        while (i < _nodes.size()) {
+            if (_nodes[i].dirty == false) {
+                i++;
+                continue;
+            }
+            const std::size_t end = i + _nodes[i].size;
+            for (; i < end; i++) {
+                f(_nodes[i].entity, _nodes[i].parent);
+                _nodes[i].dirty = false;
+            }
+        }
+    }
+
+    /**
+     * @brief Renumber the entities of the hierarchy, the entities without a
+     *        new id are removed (their children become roots)
+     * @param remap The new id of each old entity id
+     */
+    inline void compact(const std::vector<EntityId>& remap)
+    {
+        prune([&remap](const Entity& e) {
+            return e.id < remap.size() && remap[e.id] != InvalidEntityId;
+        });
+        _slots.clear();
+        for (std::size_t i = 0; i < _nodes.size(); i++) {
+            Node& node = _nodes[i];
+            node.entity.id = remap[node.entity.id];
+            if (node.parent.id != InvalidEntityId)
+                node.parent.id = remap[node.parent.id];
+            _slots.at(node.entity.id) = i + 1;
+        }
+    }
+
+    /**
+     * @brief Remove every entity from the hierarchy
+     */
+    inline void clear()
+    {
+        _nodes.clear();
+        _slots.clear();
+    }
+
+    /**
+     * @brief Copy the hierarchy as (entity, parent) pairs in depth-first order
+     * @param out The list to write to
+     */
+    inline void save(std::vector<std::pair<Entity, Entity>>& out) const
+    {
+        out.clear();
+        out.reserve(_nodes.size());
+        for (const auto& node : _nodes)
+            out.emplace_back(node.entity, node.parent);
+    }
+
+    /**
+     * @brief Replace the hierarchy by one written by save(), every entity is
+     *        marked dirty
+     * @param in The (entity, parent) pairs in depth-first order
+     */
+    inline void load(const std::vector<std::pair<Entity, Entity>>& in)
+    {
+        clear();
+        _nodes.reserve(in.size());
+        for (const auto& [entity, parent] : in) {
+            const std::size_t p = _find(parent);
+            const std::uint32_t depth = p == _nodes.size() ? 0 : _nodes[p].depth + 1;
+            _nodes.push_back(Node { entity, parent, depth, 1, true });
+            _slots.at(entity.id) = _nodes.size();
+        }
+        for (std::size_t i = _nodes.size(); i-- > 0;) {
+            const std::size_t p = _find(_nodes[i].parent);
+            if (p != _nodes.size())
+                _nodes[p].size += _nodes[i].size;
+        }
+    }
+
+    /**
+     * @brief Remove the entities that are not alive anymore (their children
+     *        become roots)
+     * @param alive Tells if an entity is alive
+     * @tparam F The type of the function
+     */
+    template <typename F>
+    inline void prune(const F& alive)
+    {
+        std::vector<Entity> dead;
+
+        for (const auto& node : _nodes)
+            if (alive(node.entity) == false)
+                dead.push_back(node.entity);
+        for (const auto& e : dead)
+            remove(e);
+    }
+};
+
+/**
+ * @brief An axis aligned bounding box
+ */
+struct AABB {
+    /**
+     * @brief The left of the box
+     */
+    float minX = 0;
+
+    /**
+     * @brief The top of the box
+     */
+    float minY = 0;
+
+    /**
+     * @brief The right of the box
+     */
+    float maxX = 0;
+
+    /**
+     * @brief The bottom of the box
+     */
+    float maxY = 0;
+
+    /**
+     * @brief Tells if the box overlaps the other one (borders included)
+     * @param other The other box
+     * @return true The boxes overlap
+     * @return false The boxes do not overlap
+     */
+    inline bool overlaps(const AABB& other) const
+    {
+        return minX <= other.maxX && other.minX <= maxX
+            && minY <= other.maxY && other.minY <= maxY;
+    }
+
+    /**
+     * @brief Get the squared distance from the given point to the box
+     *        (0 if the point is inside)
+     * @param x The x of the point
+     * @param y The y of the point
+     * @return float The squared distance
+     */
+    inline float distance2(const float& x, const float& y) const
+    {
+        const float dx = std::max({ minX - x, 0.f, x - maxX });
+        const float dy = std::max({ minY - y, 0.f, y - maxY });
+        return dx * dx + dy * dy;
+    }
+};
+
+/**
+ * @brief Computes the Z-order (Morton) code of a position: close positions
+ *        get close codes, so sorting by it keeps neighbours close in memory
+ * @param x The x of the position
+ * @param y The y of the position
+ * @param cellSize The positions in the same cell share the same code
+ * @return std::uint64_t The code
+ */
+inline std::uint64_t morton(const float& x, const float& y, const float& cellSize = 1.f)
+{
+    const auto quantize = [&cellSize](const float& v) {
+        const double cell = std::floor(static_cast<double>(v) / cellSize);
+        return static_cast<std::uint64_t>(
+            static_cast<std::int64_t>(std::clamp(cell, -2147483648.0, 2147483647.0)) + 2147483648ll);
+    };
+    const auto spread = [](std::uint64_t v) {
+        v = (v | v << 16) & 0x0000ffff0000ffffull;
+        v = (v | v << 8) & 0x00ff00ff00ff00ffull;
+        v = (v | v << 4) & 0x0f0f0f0f0f0f0f0full;
+        v = (v | v << 2) & 0x3333333333333333ull;
+        v = (v | v << 1) & 0x5555555555555555ull;
+        return v;
+    };
+    return spread(quantize(x)) | spread(quantize(y)) << 1;
+}
+
+/**
+ * @brief A uniform hash grid of boxes, queried by area, radius or nearest
+ *        neighbours (see registry::addSpatialIndex to keep one in sync with
+ *        a component)
+ *        A box is stored in every cell it overlaps, so the cell size should
+ *        be about the size of the usual box
+ */
+class SpatialGrid {
+private:
+    /**
+     * @brief The cells covered by a box (inclusive)
+     */
+    struct Cells {
+        std::int32_t x0, y0, x1, y1;
+
+        inline bool operator==(const Cells& other) const
+        {
+            return x0 == other.x0 && y0 == other.y0 && x1 == other.x1 && y1 == other.y1;
+        }
+    };
+
+    /**
+     * @brief A box of the grid
+     */
+    struct Entry {
+        Entity entity;
+        AABB box;
+        Cells cells;
+    };
+
+    /**
+     * @brief The size of a cell
+     */
+    float _cellSize;
+
+    /**
+     * @brief The boxes
+     */
+    std::pmr::vector<Entry> _entries;
+
+    /**
+     * @brief The index + 1 of the box of each entity (0 if not in the grid)
+     */
+    priv::PagedArray<std::size_t> _slots;
+
+    /**
+     * @brief The entities in each non empty cell
+     */
+    std::pmr::unordered_map<std::uint64_t, std::pmr::vector<EntityId>> _cells;
+
+    /**
+     * @brief The bounds of the cells ever used (to stop nearest_k)
+     */
+    Cells _bounds = { 0, 0, -1, -1 };
+
+    /**
+     * @brief Get the cell of the given coordinate
+     * @param v The coordinate
+     * @return std::int32_t The cell
+     */
+    inline std::int32_t _cell(const float& v) const
+    {
+        return static_cast<std::int32_t>(std::floor(v / _cellSize));
+    }
+
+    /**
+     * @brief Get the cells covered by the given box
+     * @param box The box
+     * @return Cells The cells
+     */
+    inline Cells _range(const AABB& box) const
+    {
+        return { _cell(box.minX), _cell(box.minY), _cell(box.maxX), _cell(box.maxY) };
+    }
+
+    /**
+     * @brief Get the key of the given cell
+     * @param x The x of the cell
+     * @param y The y of the cell
+     * @return std::uint64_t The key
+     */
+    static inline std::uint64_t _key(const std::int32_t& x, const std::int32_t& y)
+    {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32
+            | static_cast<std::uint32_t>(y);
+    }
+
+    /**
+     * @brief Adds or removes the given entity in the given cells
+     * @param e The entity
+     * @param cells The cells
+     * @param add Add if true, remove otherwise
+     */
+    inline void _link(const EntityId& e, const Cells& cells, const bool& add)
+    {
+        for (std::int32_t x = cells.x0; x <= cells.x1; x++)
+            for (std::int32_t y = cells.y0; y <= cells.y1; y++) {
+                if (add) {
+                    _cells[_key(x, y)].push_back(e);
+                    continue;
+                }
+                const auto it = _cells.find(_key(x, y));
+                if (it == _cells.end())
+                    continue;
+                auto& ids = it->second;
+                const auto id = std::find(ids.begin(), ids.end(), e);
+                if (id != ids.end()) {
+                    *id = ids.back();
+                    ids.pop_back();
+                }
+                if (ids.empty())
+                    _cells.erase(it);
+            }
+        if (add) {
+            _bounds = _bounds.x0 > _bounds.x1 ? cells
+                                              : Cells { std::min(_bounds.x0, cells.x0),
+                                                    std::min(_bounds.y0, cells.y0),
+                                                    std::max(_bounds.x1, cells.x1),
+                                                    std::max(_bounds.y1, cells.y1) };
+        }
+    }
+
+    /**
+     * @brief Calls f(entry) once for each box stored in the given cells
+     * @param cells The cells
+     * @param f The function to call
+     * @tparam F The type of the function
+     */
+    template <typename F>
+    inline void _each(const Cells& cells, const F& f) const
+    {
+        for (std::int32_t x = cells.x0; x <= cells.x1; x++)
+            for (std::int32_t y = cells.y0; y <= cells.y1; y++) {
+                const auto it = _cells.find(_key(x, y));
+                if (it == _cells.end())
+                    continue;
+                for (const auto& id : it->second) {
+                    const Entry& entry = _entries[*_slots.find(id) - 1];
+                    // a box spanning several cells is only reported by its
+                    // first cell inside the range
+                    if (std::max(entry.cells.x0, cells.x0) == x
+                        && std::max(entry.cells.y0, cells.y0) == y)
+                        f(entry);
+                }
+            }
+    }
+
+public:
+    /**
+     * @brief Construct a new empty grid
+     * @param cellSize The size of a cell
+     * @param resource The resource the grid is allocated from
+     */
+    inline SpatialGrid(const float& cellSize,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : _cellSize(cellSize)
+        , _entries(resource)
+        , _slots(resource)
+        , _cells(resource)
+    {
+        if (cellSize <= 0)
+            throw Error("SpatialGrid: the cell size must be positive");
+    }
+
+    /**
+     * @brief Tells if the given entity is in the grid
+     * @param e The entity
+     * @return true The entity is in the grid
+     * @return false The entity is not in the grid
+     */
+    inline bool has(const Entity& e) const
+    {
+        const std::size_t* slot = _slots.find(e.id);
+        return slot != nullptr && *slot != 0;
+    }
+
+    /**
+     * @brief Adds the given entity or moves its box
+     *        (the cells are only touched when the box changes of cells)
+     * @param e The entity
+     * @param box The box of the entity
+     */
+    inline void set(const Entity& e, const AABB& box)
+    {
+        std::size_t& slot = _slots.at(e.id);
+        const Cells cells = _range(box);
+
+        if (slot == 0) {
+            _entries.push_back(Entry { e, box, cells });
+            slot = _entries.size();
+            _link(e.id, cells, true);
+            return;
+        }
+        Entry& entry = _entries[slot - 1];
+        entry.box = box;
+        if (entry.cells == cells)
+            return;
+        _link(e.id, entry.cells, false);
+        _link(e.id, cells, true);
+        entry.cells = cells;
+    }
+
+    /**
+     * @brief Removes the given entity from the grid
+     * @param e The entity
+     */
+    inline void remove(const Entity& e)
+    {
+        std::size_t* slot = _slots.find(e.id);
+        if (slot == nullptr || *slot == 0)
+            return;
+        const std::size_t i = *slot - 1;
+        _link(e.id, _entries[i].cells, false);
+        *slot = 0;
+        if (i + 1 != _entries.size()) {
+            _entries[i] = _entries.back();
+            _slots.at(_entries[i].entity.id) = i + 1;
+        }
+        _entries.pop_back();
+    }
+
+    /**
+     * @brief Remove every entity from the grid
+     */
+    inline void clear()
+    {
+        _entries.clear();
+        _slots.clear();
+        _cells.clear();
+        _bounds = { 0, 0, -1, -1 };
+    }
+
+    /**
+     * @brief Get the number of entities in the grid
+     * @return std::size_t The number of entities
+     */
+    inline std::size_t size() const { return _entries.size(); }
+
+    /**
+     * @brief Get the entities of the grid
+     * @param f Called with each entity and its box
+     * @tparam F The type of the function
+     */
+    template <typename F>
+    inline void each(const F& f) const
+    {
+        for (const auto& entry : _entries)
+            f(entry.entity, entry.box);
+    }
+
+    /**
+     * @brief Finds the entities whose box overlaps the given box
+     * @param box The box to search
+     * @param out The buffer receiving the entities (cleared first)
+     * @return std::size_t The number of entities found
+     */
+    inline std::size_t query_aabb(const AABB& box, std::vector<Entity>& out) const
+    {
+        out.clear();
+        _each(_range(box), [&box, &out](const Entry& entry) {
+            if (entry.box.overlaps(box))
+                out.push_back(entry.entity);
+        });
+        return out.size();
+    }
+
+    /**
+     * @brief Finds the entities whose box is at most at the given distance
+     *        of the given point
+     * @param x The x of the point
+     * @param y The y of the point
+     * @param radius The distance
+     * @param out The buffer receiving the entities (cleared first)
+     * @return std::size_t The number of entities found
+     */
+    inline std::size_t query_radius(const float& x, const float& y, const float& radius,
+        std::vector<Entity>& out) const
+    {
+        const float r2 = radius * radius;
+
+        out.clear();
+        _each(_range(AABB { x - radius, y - radius, x + radius, y + radius }),
+            [&x, &y, &r2, &out](const Entry& entry) {
+                if (entry.box.distance2(x, y) <= r2)
+                    out.push_back(entry.entity);
+            });
+        return out.size();
+    }
+
+    /**
+     * @brief Finds the k entities whose box is the closest to the given point
+     *        by searching rings of cells around it
+     * @param x The x of the point
+     * @param y The y of the point
+     * @param k The number of entities to find
+     * @param out The buffer receiving the entities, closest first (cleared first)
+     * @return std::size_t The number of entities found (less than k if the
+     *         grid is smaller)
+     */
+    inline std::size_t nearest_k(const float& x, const float& y, const std::size_t& k,
+        std::vector<Entity>& out) const
+    {
+        std::vector<std::pair<float, Entity>> best;
+        const auto closer = [](const auto& a, const auto& b) { return a.first < b.first; };
+        const std::int32_t cx = _cell(x);
+        const std::int32_t cy = _cell(y);
+        const std::int32_t minRing = std::max({ _bounds.x0 - cx, cx - _bounds.x1,
+            _bounds.y0 - cy, cy - _bounds.y1, 0 });
+        const std::int32_t maxRing = std::max({ cx - _bounds.x0, _bounds.x1 - cx,
+            cy - _bounds.y0, _bounds.y1 - cy, 0 });
+
+        out.clear();
+        if (k == 0 || _entries.empty())
+            return 0;
+        best.reserve(k + 1);
+        for (std::int32_t ring = minRing; ring <= maxRing; ring++) {
+            // every box not seen yet is at least this far
+            const float reach = (ring - 1) * _cellSize;
+            if (best.size() == k && ring > minRing && reach * reach > best.front().first)
+                break;
+            const auto visit = [&](const std::int32_t& gx, const std::int32_t& gy) {
+                const auto it = _cells.find(_key(gx, gy));
+                if (it == _cells.end())
+                    return;
+                for (const auto& id : it->second) {
+                    const Entry& entry = _entries[*_slots.find(id) - 1];
+                    const float d = entry.box.distance2(x, y);
+                    if (best.size() == k && d >= best.front().first)
+                        continue;
+                    if (std::any_of(best.begin(), best.end(),
+                            [&id](const auto& b) { return b.second.id == id; }))
+                        continue;
+                    best.emplace_back(d, entry.entity);
+                    std::push_heap(best.begin(), best.end(), closer);
+                    if (best.size() > k) {
+                        std::pop_heap(best.begin(), best.end(), closer);
+                        best.pop_back();
+                    }
+                }
+            };
+            // only the part of the ring inside the used cells is visited
+            const std::int32_t x0 = std::max(cx - ring, _bounds.x0);
+            const std::int32_t x1 = std::min(cx + ring, _bounds.x1);
+            const std::int32_t y0 = std::max(cy - ring + 1, _bounds.y0);
+            const std::int32_t y1 = std::min(cy + ring - 1, _bounds.y1);
+            for (std::int32_t gx = x0; gx <= x1; gx++) {
+                visit(gx, cy - ring);
+                if (ring != 0)
+                    visit(gx, cy + ring);
+            }
+            for (std::int32_t gy = y0; gy <= y1; gy++) {
+                visit(cx - ring, gy);
+                visit(cx + ring, gy);
+            }
+        }
+        std::sort_heap(best.begin(), best.end(), closer);
+        for (const auto& b : best)
+            out.push_back(b.second);
+        return out.size();
+    }
+};
+
+namespace priv {
+
+    /**
+     * @brief Type erased spatial index of a component
+     */
+    class ISpatialIndex {
+    public:
+        virtual ~ISpatialIndex() = default;
+
+        /**
+         * @brief Moves the boxes of the entities to their current component
+         *        value and drops the entities that lost the component
+         * @param r The registry
+         */
+        virtual void sync(const registry& r) = 0;
+
+        /**
+         * @brief Get the grid
+         * @return SpatialGrid& The grid
+         */
+        virtual SpatialGrid& grid() = 0;
+    };
+
+    /**
+     * @brief Spatial index kept in sync with the component T
+     * @tparam T The type of the component
+     */
+    template <typename T>
+    class SpatialIndex : public ISpatialIndex {
+    private:
+        /**
+         * @brief The grid
+         */
+        SpatialGrid _grid;
+
+        /**
+         * @brief Computes the box of a component
+         */
+        std::function<AABB(const T&)> _bounds;
+
+    public:
+        /**
+         * @brief Construct a new Spatial Index
+         * @param cellSize The size of a cell of the grid
+         * @param bounds Computes the box of a component
+         * @param resource The resource the grid is allocated from
+         */
+        inline SpatialIndex(const float& cellSize, const std::function<AABB(const T&)>& bounds,
+            std::pmr::memory_resource* resource)
+            : _grid(cellSize, resource)
+            , _bounds(bounds)
+        {
+        }
+
+        /**
+         * @brief Moves the boxes of the entities to their current component
+         *        value and drops the entities that lost the component
+         * @param r The registry
+         */
+        inline void sync(const registry& r) override;
+
+        /**
+         * @brief Get the grid
+         * @return SpatialGrid& The grid
+         */
+        inline SpatialGrid& grid() override { return _grid; }
+    };
+
+}
+
+/**
+ * @brief The registry is the container of all the entities and components
+ *        It also contains the systems that are updated at each call of update
+ *        Every component type is stored in its own pool and all the memory
+ *        of the registry comes from the memory resource it is built with
+ *
+ */
+class registry {
+private:
+    /**
+     * @brief The resource all the pools, systems and views allocate from
+     */
+    std::pmr::memory_resource* _resource;
+
+    /**
+     * @brief The index from template name (typeid)
+     */
+    std::unordered_map<TypeNameId, ComponentIndex> _componentToIndex;
+
+    /**
+     * @brief The component index + 1 of each priv::typeId (0 means not
+     *        cached yet), so finding a pool is a single indexed load
+     */
+    std::vector<ComponentIndex> _typeToIndex;
+
+    /**
+     * @brief The pool of each component (uses ComponentIndex)
+     */
+    std::vector<std::unique_ptr<priv::IPool>> _pools;
+
+    /**
+     * @brief Tells which entities are alive
+     *        (paged so creating entities never moves the existing ones)
+     */
+    priv::PagedArray<bool> _entities;
+
+    /**
+     * @brief The ids of all the removed entities to reuse them
+     *        (the lowest ids are reused first to keep the entities dense)
+     */
+    priv::IdHeap _removedEntitiesIds;
+
+    /**
+     * @brief The next index of the entities
+     */
+    EntityId _lastEntityId = 0;
+
+    /**
+     * @brief The number of ids handed out by reserve_concurrent since the
+     *        last commit (they directly follow _lastEntityId)
+     */
+    priv::MovableAtomic<EntityId> _reserved { 0 };
+
+    /**
+     * @brief The prefabs that can be instantiated (uses tags)
+     */
+    std::unordered_map<std::string, Prefab> _prefabs;
+
+    /**
+     * @brief The systems that are updated at each call of update (uses tags)
+     *        Kept sorted by stage, then in the order they were added, so
+     *        update only walks a flat vector
+     */
+    std::vector<std::pair<std::string, std::unique_ptr<priv::System>>> _systems;
+
+    /**
+     * @brief The parent / child relationships between the entities
+     */
+    Hierarchy _hierarchy;
+
+    /**
+     * @brief The spatial indexes and the component they follow
+     */
+    std::vector<std::pair<ComponentIndex, std::unique_ptr<priv::ISpatialIndex>>> _spatial;
+
+    /**
+     * @brief The last used entity (used to avoid passing the entity each time
+     * as a parameter)
+     */
+    Entity _lastUsedEntity = Entity(0);
+
+    /**
+     * @brief The last used system (used to avoid passing the system name each
+     * time as a parameter)
+     */
+    std::string _lastUsedSystem = "";
+
+    /**
+     * @brief The calls counted during the last frame (see SILVA_COUNTERS)
+     */
+    std::vector<AccessStats> _accessStats;
+
+#if SILVA_COUNTERS
+    /**
+     * @brief The calls made outside of the systems during the current frame
+     *        (per ComponentIndex)
+     */
+    std::vector<priv::AccessCounts> _counts;
+
+    /**
+     * @brief The system being updated (nullptr outside of the systems)
+     */
+    priv::System* _countingSystem = nullptr;
+
+    /**
+     * @brief Counts a call on the given component
+     * @param component The component
+     * @param field The kind of call
+     */
+    inline void _count(const ComponentIndex& component, std::size_t priv::AccessCounts::*field)
+    {
+        auto& counts = _countingSystem ? _countingSystem->counts() : _counts;
+        if (component >= counts.size())
+            counts.resize(component + 1);
+        counts[component].*field += 1;
+    }
+#endif
+
+    /**
+     * @brief Ends the frame of the access counters: the counts become the
+     *        ones returned by accessStats and start again from zero
+     */
+    inline void _rollCounters()
+    {
+#if SILVA_COUNTERS
+        const auto collect = [this](std::vector<priv::AccessCounts>& counts,
+                                 const std::string& tag, const std::size_t& entities) {
+            for (ComponentIndex i = 0; i < counts.size(); i++) {
+                const priv::AccessCounts& n = counts[i];
+                if (n.get + n.has + n.emplace + n.views == 0)
+                    continue;
+                _accessStats.push_back(AccessStats {
+                    _pools[i]->stats().name, tag, entities, n.get, n.has, n.emplace, n.views });
+                counts[i] = priv::AccessCounts();
+            }
+        };
+
+        _accessStats.clear();
+        _countingSystem = nullptr;
+        collect(_counts, "", 0);
+        for (auto& sys : _systems)
+            collect(sys.second->counts(), sys.first, sys.second->lastUpdated());
+#endif
+    }
+
+    /**
+     * @brief Updates the given system (and counts its calls to the registry)
+     * @param sys The system
+     */
+    inline void _run(priv::System& sys)
+    {
+#if SILVA_COUNTERS
+        _countingSystem = &sys;
+        sys.update(*this);
+        _countingSystem = nullptr;
+#else
+        sys.update(*this);
+#endif
+    }
+
+    /**
+     * @brief Tells if the given Entity is alive
+     * @param e The index to the Entity
+     * @return true The entity is alive
+     * @return false The entity is not alive
+     */
+    inline bool _alive(const EntityId& e) const
+    {
+        const bool* alive = _entities.find(e);
+        return alive != nullptr && *alive;
+    }
+
+    /**
+     * @brief Transform the given type to a string hashes it
+     *        and uses it as a key to store the component index
+     *        If the type is not registered yet, it registers it
+     *        and creates its pool
+     * @return ComponentIndex The index of the component
+     */
+    template <typename T>
+    inline ComponentIndex _cti()
+    {
+        using Type = std::remove_cv_t<std::remove_reference_t<T>>;
+        const std::size_t type = priv::typeId<Type>();
+        if (type < _typeToIndex.size() && _typeToIndex[type] != 0)
+            return _typeToIndex[type] - 1;
+        return _registerType<Type>(type);
+    }
+
+    /**
+     * @brief Finds or creates the pool of the given type and caches its
+     *        index (slow path of _cti, kept out of line)
+     * @param type The priv::typeId of the type
+     * @tparam Type The type of the component
+     * @return ComponentIndex The index of the component
+     */
+    template <typename Type>
+    ComponentIndex _registerType(const std::size_t& type)
+    {
+        TypeNameId name = typeid(Type).name();
+        const auto it = _componentToIndex.find(name);
+        if (it == _componentToIndex.end()) {
+            const auto pool = std::find_if(_pools.begin(), _pools.end(),
+                [hash = priv::typeHash(name)](const auto& p) { return p->hash() == hash; });
+            if (pool != _pools.end() && dynamic_cast<priv::Pool<Type>*>(pool->get()) == nullptr) {
+                if constexpr (priv::is_bulk_copyable_v<Type> == false)
+                    throw Error(std::string(name)
+                        + " was registered from a TypeDescriptor and can not be used as a C++ type");
+                if ((*pool)->stride() != sizeof(Type))
+                    throw Error(std::string(name) + " was registered with another size");
+                auto typed = std::make_unique<priv::Pool<Type>>(_resource);
+                typed->load((*pool)->owners(), (*pool)->raw(), (*pool)->size());
+                *pool = std::move(typed);
+            }
+            _componentToIndex[name] = pool - _pools.begin();
+            if (pool == _pools.end())
+                _pools.push_back(std::make_unique<priv::Pool<Type>>(_resource));
+        }
+        if (type >= _typeToIndex.size())
+            _typeToIndex.resize(type + 1, 0);
+        _typeToIndex[type] = _componentToIndex[name] + 1;
+        return _typeToIndex[type] - 1;
+    }
+
+    /**
+     * @brief Get the pool of the given component type
+     * @tparam T The type of the component
+     * @return priv::Pool<T>& The pool of the component
+     */
+    template <typename T>
+    inline priv::Pool<std::remove_cv_t<std::remove_reference_t<T>>>& _pool()
+    {
+        return static_cast<priv::Pool<std::remove_cv_t<std::remove_reference_t<T>>>&>(
+            *_pools[_cti<T>()]);
+    }
+
+    /**
+     * @brief Get the pool of the given component type without registering it
+     * @tparam T The type of the component
+     * @return const priv::Pool<T>* The pool of the component (nullptr if the
+     *         type is not registered)
+     */
+    template <typename T>
+    inline const priv::Pool<std::remove_cv_t<std::remove_reference_t<T>>>* _find() const
+    {
+        using Type = std::remove_cv_t<std::remove_reference_t<T>>;
+        const std::size_t type = priv::typeId<Type>();
+        if (type < _typeToIndex.size() && _typeToIndex[type] != 0)
+            return static_cast<const priv::Pool<Type>*>(_pools[_typeToIndex[type] - 1].get());
+        const auto it = _componentToIndex.find(typeid(Type).name());
+        if (it == _componentToIndex.end())
+            return nullptr;
+        return static_cast<const priv::Pool<Type>*>(_pools[it->second].get());
+    }
+
+    /**
+     * @brief Get the system of the given tag
+     * @param tag The tag of the system
+     * @return priv::System& The system
+     */
+    inline priv::System& _system(const std::string& tag)
+    {
+        for (auto& sys : _systems)
+            if (sys.first == tag)
+                return *sys.second;
+        throw Error("Unknown system: " + tag);
+    }
+
+    /**
+     * @brief Fills the given system from scratch by walking the smallest pool
+     *        it depends on
+     * @param sys The system to rebuild
+     */
+    inline void _rebuildSystem(priv::System& sys)
+    {
+        const auto& deps = sys.dependencies();
+        std::vector<Entity> es;
+
+        if (deps.empty()) {
+            sys.clear();
+            return;
+        }
+        const ComponentIndex smallest = *std::min_element(deps.begin(), deps.end(),
+            [this](const ComponentIndex& a, const ComponentIndex& b) {
+                return _pools[a]->size() < _pools[b]->size();
+            });
+        const EntityId* owners = _pools[smallest]->owners();
+        es.reserve(_pools[smallest]->size());
+        for (std::size_t i = 0; i < _pools[smallest]->size(); i++) {
+            const Entity e(owners[i]);
+            if (std::all_of(deps.begin(), deps.end(),
+                    [&](const ComponentIndex& dep) { return _pools[dep]->has(e.id); }))
+                es.push_back(e);
+        }
+        sys.load(es);
+    }
+
+    /**
+     * @brief Prefab components fill the pools directly
+     */
+    template <typename T>
+    friend class priv::PrefabComponent;
+
+    /**
+     * @brief Spatial indexes read the pools directly
+     */
+    template <typename T>
+    friend class priv::SpatialIndex;
+
+    /**
+     * @brief Views on a const registry read the pools directly
+     */
+    template <typename T, typename... Args>
+    friend class View;
+
+    /**
+     * @brief Writes the pools directly
+     */
+    friend void save(const registry& r, const std::string& path);
+
+    /**
+     * @brief Reads the pools directly
+     */
+    friend void load_mmap(registry& r, const std::string& path);
+
+    /**
+     * @brief Moves the components pool to pool
+     */
+    friend Entity move_entity(registry& from, registry& to, const Entity& e);
+
+    /**
+     * @brief Adds to the given system a dependency of the given type
+     * @param sys The system to add the dependency to
+     * @tparam T The type of the dependency
+     * @return registry& The registry to chain the calls
+     */
+    template <typename T>
+    inline registry& _addSystemDeps(priv::System& sys)
+    {
+        sys.addDependency(_cti<T>());
+        for (unsigned int i = 0; i < _lastEntityId; i++)
+            sys.onEntityUpdate(*this, Entity(i));
+        return *this;
+    }
+
+    /**
+     * @brief Adds to the given system a dependency of the given type
+     * @tparam T The type of the dependency
+     * @tparam ...Args The other types of the dependencies
+     * @return registry& The registry to chain the calls
+     */
+    template <typename T, typename... Args,
+        typename std::enable_if<sizeof...(Args) != 0>::type* = nullptr>
+    inline registry& _addSystemDeps(priv::System& sys)
+    {
+        sys.addDependency(_cti<T>());
+        return _addSystemDeps<Args...>(sys);
+    }
+
+public:
+    /**
+     * @brief Construct a new registry
+     * @param resource The resource all the pools, systems and views allocate
+     * from (an Arena can be given to release a whole level at once)
+     */
+    inline registry(
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : _resource(resource)
+        , _entities(resource)
+        , _hierarchy(resource)
+    {
+    }
+
+    /**
+     * @brief Get the resource the registry allocates from
+     * @return std::pmr::memory_resource* The resource
+     */
+    inline std::pmr::memory_resource* resource() const { return _resource; }
+
+    /**
+     * @brief Get the parent / child relationships between the entities
+     *        (removed entities leave it, their children become roots)
+     * @return Hierarchy& The hierarchy
+     */
+    inline Hierarchy& hierarchy() { return _hierarchy; }
+
+    /**
+     * @brief Get the parent / child relationships between the entities
+     * @return const Hierarchy& The hierarchy
+     */
+    inline const Hierarchy& hierarchy() const { return _hierarchy; }
+
+    /**
+     * @brief Registers the given component type (creates its pool)
+     *        Types are registered on first use, this is needed to load them
+     *        from a file before any use
+     * @tparam T The type of the component
+     * @return ComponentIndex The index of the component
+     */
+    template <typename T>
+    inline ComponentIndex registerComponent() { return _cti<T>(); }
+
+    /**
+     * @brief Registers a component type described at runtime (creates its
+     *        pool), so tools and level loaders can store components without
+     *        a C++ type; a descriptor of the name of a registered type gives
+     *        back its pool if the layout matches (throws otherwise)
+     *        Descriptors made by TypeDescriptor::of() create a Pool<T>, the
+     *        others a RawPool
+     * @param type The description of the type
+     * @return ComponentIndex The index of the component
+     */
+    inline ComponentIndex registerComponent(const TypeDescriptor& type)
+    {
+        const std::uint64_t hash = priv::typeHash(type.name.c_str());
+
+        for (ComponentIndex i = 0; i < _pools.size(); i++)
+            if (_pools[i]->hash() == hash) {
+                if (_pools[i]->stride() != (type.trivial() ? type.size : 0))
+                    throw Error("registerComponent(): " + type.name
+                        + " is already registered with another layout");
+                return i;
+            }
+        if (type.pool != nullptr)
+            _pools.push_back(type.pool(_resource));
+        else
+            _pools.push_back(std::make_unique<priv::RawPool>(type, _resource));
+        return _pools.size() - 1;
+    }
+
+    /**
+     * @brief Sets a copy of the given component on the given Entity
+     *        (replaces the old one)
+     * @param e The entity
+     * @param component The index of the component
+     * @param value The component (of the registered type of the pool)
+     * @return registry& The registry to chain the calls
+     */
+    inline registry& emplaceRaw(const Entity& e, const ComponentIndex& component, const void* value)
+    {
+        _lastUsedEntity = e;
+        if (_alive(e.id) == false)
+            throw Error("Trying to emplace on an unset index: "
+                + std::to_string(e.id));
+        if (component >= _pools.size())
+            throw Error("emplaceRaw(): unregistered component " + std::to_string(component));
+        SILVA_COUNT(component, emplace);
+        if (_pools[component]->assign(e.id, value))
+            for (auto& sys : _systems)
+                sys.second->onEntityUpdate(*this, e);
+        return *this;
+    }
+
+    /**
+     * @brief Copies a block of components to the given entities at once
+     *        (e.g. read from a level file)
+     *        Only for components that are plain bytes
+     * @param component The index of the component
+     * @param es The entities
+     * @param data The components, one per entity (es.size() * size bytes)
+     * @return registry& The registry to chain the calls
+     */
+    inline registry& loadComponents(
+        const ComponentIndex& component, const std::vector<Entity>& es, const void* data)
+    {
+        if (component >= _pools.size())
+            throw Error("loadComponents(): unregistered component " + std::to_string(component));
+        priv::IPool& pool = *_pools[component];
+        const std::size_t stride = pool.stride();
+        if (stride == 0)
+            throw Error("loadComponents(): the component " + std::to_string(component)
+                + " can not be loaded from raw bytes");
+        for (const auto& e : es)
+            if (_alive(e.id) == false)
+                throw Error("Trying to emplace on an unset index: "
+                    + std::to_string(e.id));
+        for (std::size_t i = 0; i < es.size(); i++)
+            pool.assign(es[i].id, static_cast<const unsigned char*>(data) + i * stride);
+        for (auto& sys : _systems)
+            for (const auto& e : es)
+                sys.second->onEntityUpdate(*this, e);
+        return *this;
+    }
+
+    /**
+     * @brief Returns the given Component of the given Entity
+     * @param e The entity
+     * @param component The index of the component
+     * @return void* The component (nullptr if the entity has none)
+     */
+    inline void* getRaw(const Entity& e, const ComponentIndex& component)
+    {
+        return component < _pools.size() ? _pools[component]->find(e.id) : nullptr;
+    }
+
+    /**
+     * @brief Returns the given Component of the given Entity
+     * @param e The entity
+     * @param component The index of the component
+     * @return const void* The component (nullptr if the entity has none)
+     */
+    inline const void* getRaw(const Entity& e, const ComponentIndex& component) const
+    {
+        return component < _pools.size() ? _pools[component]->find(e.id) : nullptr;
+    }
+
+    /**
+     * @brief Removes the given Component from the given Entity
+     *        (does nothing if the entity does not have it)
+     * @param e The entity
+     * @param component The index of the component
+     * @return registry& The registry to chain the calls
+     */
+    inline registry& removeRaw(const Entity& e, const ComponentIndex& component)
+    {
+        if (component >= _pools.size() || _pools[component]->has(e.id) == false)
+            return *this;
+        _pools[component]->remove(e.id);
+        for (auto& sys : _systems)
+            sys.second->onEntityUpdate(*this, e);
+        return *this;
+    }
+
+    /**
+     * @brief Get the number of bytes allocated by the pool of the given component
+     * @tparam T The type of the component
+     * @return std::size_t The number of bytes
+     */
+    template <typename T>
+    inline std::size_t bytesUsed() { return _pool<T>().bytes(); }
+
+    /**
+     * @brief Reserve room in the pool of the given component
+     * @param n The number of components
+     * @tparam T The type of the component
+     * @return registry& The registry to chain the calls
+     */
+    template <typename T>
+    inline registry& reserve(const std::size_t& n)
+    {
+        _pool<T>().reserve(n);
+        return *this;
+    }
+
+    /**
+     * @brief Loads the dependencies of the given types
+     * @tparam T The type of the system
+     * @tparam ...Args The other types of the dependencies
+     * @return std::vector<ComponentIndex>& The dependencies of the system
+     */
+    template <typename T, typename... Args,
+        typename std::enable_if<sizeof...(Args) != 0>::type* = nullptr>
+    inline std::vector<ComponentIndex>& getDepsList(std::vector<ComponentIndex>& deps)
+    {
+        deps.push_back(_cti<T>());
+        return getDepsList<Args...>(deps);
+    }
+
+    /**
+     * @brief Loads the dependencies of the given type
+     * @tparam T The type of the system
+     * @return std::vector<ComponentIndex>& The dependencies of the system
+     */
+    template <typename T, typename... Args,
+        typename std::enable_if<sizeof...(Args) == 0>::type* = nullptr>
+    inline std::vector<ComponentIndex>& getDepsList(std::vector<ComponentIndex>& deps)
+    {
+        deps.push_back(_cti<T>());
+        return deps;
+    }
+
+    /**
+     * @brief Checks wheter the given Entity has the given Component
+     * @param e The entity to check
+     * @param component The component to check
+     * @param updateLast Used to avoid passing the entity each time as a
+     * parameter (if true, _lastUsedEntity is updated to e)
+     * @return true if the entity has the component, false otherwise
+     * @return false if the entity has the component, true otherwise
+     */
+    inline bool has(const Entity& e, const ComponentIndex& component,
+        const bool& updateLast = true)
+    {
+        if (updateLast)
+            _lastUsedEntity = e;
+        return _pools[component]->has(e.id);
+    }
+
+    /**
+     * @brief Checks wheter the last used Entity has the given Component
+     * @return true if the entity has the component, false otherwise
+     * @return false if the entity has the component, true otherwise
+     */
+    inline bool has(const ComponentIndex& component)
+    {
+        return has(_lastUsedEntity, component, false);
+    }
+
+    /**
+     * @brief Returns the Component of the given Entity
+     * @param e The entity to get the component from
+     * @param updateLast Used to avoid passing the entity each time as a
+     * parameter (if true, _lastUsedEntity is updated to e)
+     * @tparam The type of the component
+     * @return true if the entity has the component, false otherwise
+     * @return false if the entity has the component, true otherwise
+     */
+    template <typename T>
+    inline bool has(const Entity& e, const bool& updateLast = true)
+    {
+        SILVA_COUNT(_cti<T>(), has);
+        return has(e, _cti<T>(), updateLast);
+    }
+
+    /**
+     * @brief Returns the Component of the last used Entity
+     * @tparam The type of the component
+     * @return true if the entity has the component, false otherwise
+     * @return false if the entity has the component, true otherwise
+     */
+    template <typename T>
+    inline bool has(const bool& updateLast = true)
+    {
+        SILVA_COUNT(_cti<T>(), has);
+        return has(_lastUsedEntity, _cti<T>(), updateLast);
+    }
+
+    /**
+     * @brief Returns the Component of the given Entity
+     * @param e The entity to get the component from
+     * @param updateLast Used to avoid passing the entity each time as a
+     * parameter (if true, _lastUsedEntity is updated to e)
+     * @tparam The type of the component
+     * @return T& The component of the entity
+     */
+    template <typename T>
+    inline T& get(const Entity& e, const bool& updateLast = true)
+    {
+        if (updateLast)
+            _lastUsedEntity = e;
+        SILVA_COUNT(_cti<T>(), get);
+        return _pool<T>().get(e.id);
+    }
+
+    /**
+     * @brief Returns the Component of the last used Entity
+     * @tparam T The type of the component
+     * @return T& The component of the entity
+     */
+    template <typename T>
+    inline T& get() { return get<T>(_lastUsedEntity, false); }
+
+    /**
+     * @brief Checks wheter the given Entity has the given Component
+     *        Does not modify the registry (safe for concurrent readers)
+     * @param e The entity to check
+     * @tparam T The type of the component
+     * @return true The entity has the component
+     * @return false The entity does not have the component
+     */
+    template <typename T>
+    inline bool has(const Entity& e) const
+    {
+        const auto* pool = _find<T>();
+        return pool != nullptr && pool->has(e.id);
+    }
+
+    /**
+     * @brief Returns the Component of the given Entity
+     *        Does not modify the registry (safe for concurrent readers)
+     * @param e The entity to get the component from
+     * @tparam T The type of the component
+     * @return const T& The component of the entity
+     */
+    template <typename T>
+    inline const T& get(const Entity& e) const
+    {
+        const auto* pool = _find<T>();
+        if (pool == nullptr)
+            throw Error(std::string("get(): unregistered component ") + typeid(T).name());
+        return pool->get(e.id);
+    }
+
+    /**
+     * @brief Returns the Component of the given Entity if it has one
+     *        Never throws and does not register the type
+     * @param e The entity to get the component from
+     * @tparam T The type of the component
+     * @return T* The component (nullptr if the entity has none)
+     */
+    template <typename T>
+    inline T* try_get(const Entity& e)
+    {
+        using Type = std::remove_cv_t<std::remove_reference_t<T>>;
+        auto* pool = const_cast<priv::Pool<Type>*>(_find<T>());
+        if (pool == nullptr)
+            return nullptr;
+        SILVA_COUNT(_cti<T>(), get);
+        return pool->tryGet(e.id);
+    }
+
+    /**
+     * @brief Returns the Component of the given Entity if it has one
+     *        Never throws and does not modify the registry
+     * @param e The entity to get the component from
+     * @tparam T The type of the component
+     * @return const T* The component (nullptr if the entity has none)
+     */
+    template <typename T>
+    inline const T* try_get(const Entity& e) const
+    {
+        const auto* pool = _find<T>();
+        return pool == nullptr ? nullptr : pool->tryGet(e.id);
+    }
+
+    /**
+     * @brief Creates a new Entity and returns it
+     *        It sets the last used Entity to the newly created one
+     * @return Entity The new Entity
+     */
+    inline Entity newEntity()
+    {
+        commit_reserved();
+        if (_removedEntitiesIds.empty()) {
+            _lastUsedEntity.id = _lastEntityId;
+            _entities.at(_lastUsedEntity.id) = true;
+            _lastEntityId++;
+            return _lastUsedEntity;
+        }
+        _lastUsedEntity = Entity(_removedEntitiesIds.top());
+        _entities.at(_lastUsedEntity.id) = true;
+        _removedEntitiesIds.pop();
+        return _lastUsedEntity;
+    }
+
+    /**
+     * @brief Creates the given number of entities at once
+     *        The removed ids are reused first (lowest first), then new ids
+     *        It sets the last used Entity to the last created one
+     * @param n The number of entities to create
+     * @return std::vector<Entity> The new entities
+     */
+    inline std::vector<Entity> newEntities(const std::size_t& n)
+    {
+        std::vector<Entity> es;
+
+        commit_reserved();
+        es.reserve(n);
+        while (es.size() < n && _removedEntitiesIds.empty() == false) {
+            es.emplace_back(_removedEntitiesIds.top());
+            _removedEntitiesIds.pop();
+        }
+        while (es.size() < n)
+            es.emplace_back(_lastEntityId++);
+        for (const auto& e : es)
+            _entities.at(e.id) = true;
+        if (es.empty() == false)
+            _lastUsedEntity = es.back();
+        return es;
+    }
+
+    /**
+     * @brief Reserves n consecutive entity ids, lock-free
+     *        Can be called from several threads at the same time (as long as
+     *        no other non-const function runs meanwhile); the entities only
+     *        become alive at the next sync point (commit_reserved, update or
+     *        any function creating or removing entities), so their components
+     *        must be added after it
+     *        Pending reservations are dropped by restore, apply and load_mmap
+     * @param n The number of ids to reserve
+     * @return Entity The first reserved entity (the others follow it)
+     */
+    inline Entity reserve_concurrent(const std::size_t& n = 1)
+    {
+        return Entity(_lastEntityId + _reserved.fetch_add(n, std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Makes the entities reserved with reserve_concurrent alive
+     *        (must not run while other threads reserve)
+     * @return registry& The registry to chain the calls
+     */
+    inline registry& commit_reserved()
+    {
+        const EntityId n = _reserved.exchange(0, std::memory_order_acquire);
+
+        for (EntityId id = _lastEntityId; id < _lastEntityId + n; id++)
+            _entities.at(id) = true;
+        _lastEntityId += n;
+        return *this;
+    }
+
+    /**
+     * @brief Register a prefab under the given tag
+     * @param tag The tag of the prefab
+     * @param prefab The prefab
+     * @return registry& The registry to chain the calls
+     */
+    inline registry& addPrefab(const std::string& tag, const Prefab& prefab)
+    {
+        _prefabs[tag] = prefab;
+        return *this;
+    }
+
+    /**
+     * @brief Removes the prefab of the given tag
+     * @param tag The tag of the prefab
+     * @return registry& The registry to chain the calls
+     */
+    inline registry& removePrefab(const std::string& tag)
+    {
+        _prefabs.erase(tag);
+        return *this;
+    }
+
+    /**
+     * @brief Creates n entities holding a copy of every component of the prefab
+     *        Each pool is filled in one go and each system is only notified
+     *        once for the whole batch
+     * @param prefab The prefab to copy
+     * @param n The number of entities to create
+     * @return std::vector<Entity> The new entities
+     */
+    inline std::vector<Entity> instantiate(const Prefab& prefab, const std::size_t& n = 1)
+    {
+        const std::vector<Entity> es = newEntities(n);
+
+        for (const auto& component : prefab.components())
+            component.second->spawn(*this, es);
+        for (auto& sys : _systems)
+            sys.second->onEntitiesCreate(*this, es);
+        return es;
+    }
+
+    /**
+     * @brief Creates n entities from the prefab of the given tag
+     * @param tag The tag of the prefab
+     * @param n The number of entities to create
+     * @return std::vector<Entity> The new entities
+     */
+    inline std::vector<Entity> instantiate(const std::string& tag, const std::size_t& n = 1)
+    {
+        try {
+            return instantiate(_prefabs.at(tag), n);
+        } catch (const std::out_of_range&) {
+            throw Error("instantiate(" + tag + "): unknown prefab");
+        }
+    }
+
+    /**
+     * @brief Removes the given Entity
+     * @param e The entity to remove
+     * @return registry& The registry to chain the calls
+     */
+    inline registry& removeEntity(const Entity& e)
+    {
+        commit_reserved();
+        if (_alive(e.id) == false)
+            return *this;
+        _entities.reset(e.id);
+        for (auto& pool : _pools)
+            pool->remove(e.id);
+        for (auto& sys : _systems)
+            sys.second->onEntityDelete(e);
+        _hierarchy.remove(e);
+        for (auto& index : _spatial)
+            index.second->grid().remove(e);
+        if (e.id + 1 == _lastEntityId) {
+            _lastEntityId--;
+            return *this;
+        }
+        _removedEntitiesIds.push(e.id);
+        return *this;
+    }
+
     /**
-     * @brief The next index of the components
+     * @brief add a new System of the given tag
+     * @param tag The tag of the system
+     * @param updateLast Used to avoid passing the system each time as a
+     * parameter (if true, _lastUsedSystem is updated to sys)
+     * @tparam T The first type of the system dependencies
+     * @tparam Args... The other types of the dependencies
+     * @return registry& The registry to chain the calls
      */
-    ComponentIndex _lastComponentIndex = 0;
+    template <typename T, typename... Args>
+    inline registry& addSystem(const std::string& tag, const bool& updateLast = true)
+    {
+        return addSystem<T, Args...>(tag, Stage::Update, updateLast);
+    }
 
     /**
-     * @brief The container of the entities holding the components
+     * @brief add a new System of the given tag in the given stage
+     *        (after the systems already in that stage)
+     * @param tag The tag of the system
+     * @param stage The stage the system runs in
+     * @param updateLast Used to avoid passing the system each time as a
+     * parameter (if true, _lastUsedSystem is updated to sys)
+     * @tparam T The first type of the system dependencies
+     * @tparam Args... The other types of the dependencies
+     * @return registry& The registry to chain the calls
      */
-    priv::SparseArray<priv::SparseArray<Component>> _entities;
+    template <typename T, typename... Args>
+    inline registry& addSystem(const std::string& tag, const Stage& stage,
+        const bool& updateLast = true)
+    {
+        if (updateLast)
+            _lastUsedSystem = tag;
+        removeSystem(tag);
+        const auto it = std::find_if(_systems.begin(), _systems.end(),
+            [&stage](const auto& sys) { return sys.second->stage() > stage; });
+        auto& sys = *_systems.insert(
+            it, { tag, std::make_unique<priv::System>(stage, _resource) })->second;
+        return _addSystemDeps<T, Args...>(sys);
+    }
 
     /**
-     * @brief The ids of all the removed entities to reuse them
+     * @brief add a new System of the given tag
+     * @param tag The tag of the system
+     * @tparam T The first type of the system dependencies
+     * @tparam Args... The other types of the dependencies
+     * @return registry& The registry to chain the calls
      */
-    std::stack<EntityId> _removedEntitiesIds;
+    template <typename T, typename... Args>
+    inline registry& addSystemDeps(
+        const std::string& tag, const bool& updateLast = true)
+    {
+        if (updateLast)
+            _lastUsedSystem = tag;
+        return _addSystemDeps<T, Args...>(_system(tag));
+    }
 
     /**
-     * @brief The next index of the entities
+     * @brief add deps to the last added System
+     * @tparam T The first type of the system dependencies
+     * @tparam Args... The other types of the dependencies
+     * @return registry& The registry to chain the calls
      */
-    EntityId _lastEntityId = 0;
+    template <typename T, typename... Args>
+    inline registry& addSystemDeps()
+    {
+        return addSystemDeps<T, Args...>(_lastUsedSystem, false);
+    }
 
     /**
-     * @brief The systems that are updated at each call of update (uses tags)
+     * @brief Removes the given System
+     * @param tag The tag of the system
+     * @return registry& The registry to chain the calls
      */
-    std::unordered_map<std::string, std::unique_ptr<priv::System>> _systems;
+    inline registry& removeSystem(const std::string& tag)
+    {
+#if SILVA_COUNTERS
+        for (const auto& sys : _systems)
+            if (sys.first == tag && sys.second.get() == _countingSystem)
+                _countingSystem = nullptr;
+#endif
+        _systems.erase(std::remove_if(_systems.begin(), _systems.end(),
+                           [&tag](const auto& sys) { return sys.first == tag; }),
+            _systems.end());
+        return *this;
+    }
 
     /**
-     * @brief The last used entity (used to avoid passing the entity each time
-     * as a parameter)
+     * @brief Set the updater function of the given System
+     * @param tag The tag of the system
+     * @param f The function to set
+     * @param updateLast Used to avoid passing the system each time as a
+     * parameter (if true, _lastUsedSystem is updated to sys)
+     * @return registry& The registry to chain the calls
      */
-    Entity _lastUsedEntity = Entity(0);
+    inline registry& setSystemUpdate(const std::string& tag, const SystemUpdater& f,
+        const bool& updateLast = true)
+    {
+        if (updateLast)
+            _lastUsedSystem = tag;
+        _system(tag).setSystemUpdate(f);
+        return *this;
+    }
 
     /**
-     * @brief The last used system (used to avoid passing the system name each
-     * time as a parameter)
+     * @brief Set the updater function of the last added System
+     * @param f The function to set
+     * @return registry& The registry to chain the calls
      */
-    std::string _lastUsedSystem = "";
+    inline registry& setSystemUpdate(const SystemUpdater& f)
+    {
+        return setSystemUpdate(_lastUsedSystem, f, false);
+    }
 
     /**
-     * @brief Hold last component resize
+     * @brief Set when the System of the given tag runs
+     * @param tag The tag of the system
+     * @param policy The run policy of the system
+     * @param updateLast Used to avoid passing the system each time as a
+     * parameter (if true, _lastUsedSystem is updated to sys)
+     * @return registry& The registry to chain the calls
      */
-    std::size_t _componentArraySize = REGISTRY_COMPONENT_SIZE;
+    inline registry& setSystemPolicy(const std::string& tag, const RunPolicy& policy,
+        const bool& updateLast = true)
+    {
+        if (updateLast)
+            _lastUsedSystem = tag;
+        _system(tag).setPolicy(policy);
+        return *this;
+    }
 
     /**
-     * @brief Update a specified entity to have it fitting the component
-     * registry
-     * @param e The index to the Entity
-     * @return true if the entity has been resized
-     * @return true if the entity has not been resized
+     * @brief Set when the last added System runs
+     * @param policy The run policy of the system
+     * @return registry& The registry to chain the calls
      */
-    inline bool _uecr(const EntityId& e)
+    inline registry& setSystemPolicy(const RunPolicy& policy)
     {
-        if (_entities.isSet(e)
-            && _entities.cget(e).size() + 1 >= _lastComponentIndex) {
-            _entities.get(e).resize(REGISTRY_COMPONENT_SIZE);
-            return true;
-        }
-        return false;
+        return setSystemPolicy(_lastUsedSystem, policy, false);
     }
 
     /**
-     * @brief Updates all the entities to be sure
-     *        to have all the Entities fitting the
-     *        component registry
-     * @return true if an entity has been resized
-     * @return false if no entity has been resized
+     * @brief Calls emplace on the last used Entity (Is used to chain emplace
+     * calls)
+     * @tparam T The type of the component
+     * @tparam Args... The types of the arguments
+     * @param args The arguments of the emplace call
+     * @return registry& The registry to chain the calls
      */
-    inline bool _uaecr()
+    template <typename T, typename... Args>
+    inline registry& emplace_r(Args&&... args)
     {
-        bool modified = false;
-        for (EntityId e = 0; e < _lastEntityId; e++)
-            if (_uecr(e))
-                modified = true;
-        return modified;
+        return emplace<T, Args...>(
+            _lastUsedEntity, std::forward<Args>(args)...);
     }
 
     /**
-     * @brief Transform the given type to a string hashes it
-     *        and uses it as a key to store the component index
-     *        If the type is not registered yet, it registers it
-     * @return ComponentIndex The index of the component
+     * @brief Calls emplace on the given Entity (Used as first emplace call)
+     * @tparam T The type of the component
+     * @tparam Args... The types of the arguments
+     * @param e The entity to emplace the component on
+     * @param args The arguments of the emplace call
+     * @return registry& The registry to chain the calls
      */
-    template <typename T>
-    inline ComponentIndex _cti()
+    template <typename T, typename... Args>
+    inline registry& emplace(const Entity& e, Args&&... args)
     {
-        TypeNameId name = typeid(T).name();
-        try {
-            return _componentToIndex.at(name);
-        } catch (...) {
-            _componentToIndex[name] = _lastComponentIndex;
-            _lastComponentIndex++;
-            if (_uaecr())
-                _componentArraySize += REGISTRY_COMPONENT_SIZE;
-            return _lastComponentIndex - 1;
-        }
+        _lastUsedEntity = e;
+        if (_alive(e.id) == false)
+            throw Error("Trying to emplace on an unset index: "
+                + std::to_string(e.id));
+        SILVA_COUNT(_cti<T>(), emplace);
+        _pool<T>().emplace(e.id, T { std::forward<Args>(args)... });
+        for (auto& sys : _systems)
+            sys.second->onEntityUpdate(*this, e);
+        return *this;
     }
 
     /**
-     * @brief Adds to the given system a dependency of the given type
-     * @param sys The system to add the dependency to
-     * @tparam T The type of the dependency
+     * @brief Updates all the systems in the registry
      * @return registry& The registry to chain the calls
      */
-    template <typename T>
-    inline registry& _addSystemDeps(priv::System& sys)
+    inline registry& update()
     {
-        sys.addDependency(_cti<T>());
-        for (unsigned int i = 0; i < _lastEntityId; i++)
-            sys.onEntityUpdate(*this, Entity(i));
+        commit_reserved();
+        _rollCounters();
+        syncSpatial();
+        for (auto& sys : _systems)
+            _run(*sys.second);
         return *this;
     }
 
     /**
-     * @brief Adds to the given system a dependency of the given type
-     * @tparam T The type of the dependency
-     * @tparam ...Args The other types of the dependencies
+     * @brief Updates the systems of the given stage only
+     *        (to run the stages at different points of the frame)
+     *        The spatial indexes are refreshed before the PreUpdate stage
+     * @param stage The stage to run
      * @return registry& The registry to chain the calls
      */
-    template <typename T, typename... Args,
-        typename std::enable_if<sizeof...(Args) != 0>::type* = nullptr>
-    inline registry& _addSystemDeps(priv::System& sys)
+    inline registry& update(const Stage& stage)
     {
-        sys.addDependency(_cti<T>());
-        return _addSystemDeps<Args...>(sys);
+        commit_reserved();
+        if (stage == Stage::PreUpdate) {
+            _rollCounters();
+            syncSpatial();
+        }
+        for (auto& sys : _systems)
+            if (sys.second->stage() == stage)
+                _run(*sys.second);
+        return *this;
     }
 
-public:
     /**
-     * @brief Loads the dependencies of the given types
-     * @tparam T The type of the system
-     * @tparam ...Args The other types of the dependencies
-     * @return std::vector<ComponentIndex>& The dependencies of the system
+     * @brief Keeps a spatial grid of the entities owning the component T
+     *        (replaces the previous index of T)
+     *        The grid follows the components at each update() (or
+     *        syncSpatial()): only the boxes that changed of cells touch the
+     *        grid, and removed entities leave it right away
+     * @param cellSize The size of a cell of the grid
+     * @param bounds Computes the box of a component
+     * @tparam T The type of the component (e.g. a position or bounds)
+     * @return registry& The registry to chain the calls
      */
-    template <typename T, typename... Args,
-        typename std::enable_if<sizeof...(Args) != 0>::type* = nullptr>
-    inline std::vector<ComponentIndex>& getDepsList(std::vector<ComponentIndex>& deps)
+    template <typename T>
+    inline registry& addSpatialIndex(
+        const float& cellSize, const std::function<AABB(const T&)>& bounds)
     {
-        deps.push_back(_cti<T>());
-        return getDepsList<Args...>(deps);
+        const ComponentIndex component = _cti<T>();
+
+        removeSpatialIndex<T>();
+        _spatial.emplace_back(component,
+            std::make_unique<priv::SpatialIndex<std::remove_cv_t<std::remove_reference_t<T>>>>(
+                cellSize, bounds, _resource));
+        _spatial.back().second->sync(*this);
+        return *this;
     }
 
     /**
-     * @brief Loads the dependencies of the given type
-     * @tparam T The type of the system
-     * @return std::vector<ComponentIndex>& The dependencies of the system
+     * @brief Drops the spatial index of the component T
+     * @tparam T The type of the component
+     * @return registry& The registry to chain the calls
      */
-    template <typename T, typename... Args,
-        typename std::enable_if<sizeof...(Args) == 0>::type* = nullptr>
-    inline std::vector<ComponentIndex>& getDepsList(std::vector<ComponentIndex>& deps)
+    template <typename T>
+    inline registry& removeSpatialIndex()
     {
-        deps.push_back(_cti<T>());
-        return deps;
+        const ComponentIndex component = _cti<T>();
+
+        _spatial.erase(std::remove_if(_spatial.begin(), _spatial.end(),
+                           [&component](const auto& index) { return index.first == component; }),
+            _spatial.end());
+        return *this;
     }
 
     /**
-     * @brief Checks wheter the given Entity has the given Component
-     * @param e The entity to check
-     * @param component The component to check
-     * @param updateLast Used to avoid passing the entity each time as a
-     * parameter (if true, _lastUsedEntity is updated to e)
-     * @return true if the entity has the component, false otherwise
-     * @return false if the entity has the component, true otherwise
+     * @brief Get the spatial grid following the component T
+     * @tparam T The type of the component
+     * @return const SpatialGrid& The grid
      */
-    inline bool has(const Entity& e, const ComponentIndex& component,
-        const bool& updateLast = true)
+    template <typename T>
+    inline const SpatialGrid& spatial() const
     {
-        if (updateLast)
-            _lastUsedEntity = e;
-        return _entities.cget(e.id).isSet(component);
+        const auto it = _componentToIndex.find(
+            typeid(std::remove_cv_t<std::remove_reference_t<T>>).name());
+        if (it != _componentToIndex.end())
+            for (const auto& index : _spatial)
+                if (index.first == it->second)
+                    return index.second->grid();
+        throw Error(std::string("spatial(): no spatial index for ") + typeid(T).name());
     }
 
     /**
-     * @brief Checks wheter the last used Entity has the given Component
-     * @return true if the entity has the component, false otherwise
-     * @return false if the entity has the component, true otherwise
+     * @brief Moves every spatial index to the current value of the components
+     * @return registry& The registry to chain the calls
      */
-    inline bool has(const ComponentIndex& component)
+    inline registry& syncSpatial()
     {
-        return has(_lastUsedEntity, component, false);
+        for (auto& index : _spatial)
+            index.second->sync(*this);
+        return *this;
     }
 
     /**
-     * @brief Returns the Component of the given Entity
-     * @param e The entity to get the component from
-     * @param updateLast Used to avoid passing the entity each time as a
-     * parameter (if true, _lastUsedEntity is updated to e)
-     * @tparam The type of the component
-     * @return true if the entity has the component, false otherwise
-     * @return false if the entity has the component, true otherwise
+     * @brief Runs a bounded part of an incremental sort of the pool of the
+     *        component T by the given key (e.g. the Morton code of a
+     *        position), to be called every frame: once sorted, each pass only
+     *        fixes the few components that moved
+     *        Views on a const registry and the spatial queries then touch
+     *        the components in memory order
+     * @param key Computes the key of a component
+     * @param budget The maximum number of components moved by this call
+     * @tparam T The type of the component
+     * @tparam K The type of the key function
+     * @return true The current sorting pass reached the end of the pool
+     * @return false The current sorting pass is not over
      */
-    template <typename T>
-    inline bool has(const Entity& e, const bool& updateLast = true)
+    template <typename T, typename K>
+    inline bool sortPool(const K& key, const std::size_t& budget)
     {
-        return has(e, _cti<T>(), updateLast);
+        return _pool<T>().sortStep(key, budget);
     }
 
     /**
-     * @brief Returns the Component of the last used Entity
-     * @tparam The type of the component
-     * @return true if the entity has the component, false otherwise
-     * @return false if the entity has the component, true otherwise
+     * @brief Sorts the whole pool of the component T by the given key at
+     *        once (to get a sorted order the incremental sort can maintain)
+     * @param key Computes the key of a component
+     * @tparam T The type of the component
+     * @tparam K The type of the key function
+     * @return registry& The registry to chain the calls
      */
-    template <typename T>
-    inline bool has(const bool& updateLast = true)
+    template <typename T, typename K>
+    inline registry& sortPool(const K& key)
     {
-        return has(_lastUsedEntity, _cti<T>(), updateLast);
+        _pool<T>().sort(key);
+        return *this;
     }
 
     /**
-     * @brief Returns the Component of the given Entity
-     * @param e The entity to get the component from
-     * @param updateLast Used to avoid passing the entity each time as a
-     * parameter (if true, _lastUsedEntity is updated to e)
-     * @tparam The type of the component
-     * @return T& The component of the entity
+     * @brief Returns the current max Entity id
+     * @return EntityId The max Entity id
      */
-    template <typename T>
-    inline T& get(const Entity& e, const bool& updateLast = true)
+    inline const EntityId& entitiesCount() const { return _lastEntityId; }
+
+    /**
+     * @brief Renumbers the alive entities densely (keeping their order),
+     *        then releases the unused capacity of the pools and systems
+     *        Components holding Entity fields should be fixed in the callback
+     *        which is called once everything has been moved
+     * @param f Function receiving the old to new Entity mapping
+     * @return registry& The registry to chain the calls
+     */
+    inline registry& compact(const std::function<void(const EntityRemap&)>& f = nullptr)
     {
-        if (updateLast)
-            _lastUsedEntity = e;
-        return std::any_cast<T&>(_entities.get(e.id).get(_cti<T>()));
+        commit_reserved();
+        std::vector<EntityId> remap(_lastEntityId, InvalidEntityId);
+        EntityId next = 0;
+
+        for (EntityId id = 0; id < _lastEntityId; id++)
+            if (_alive(id))
+                remap[id] = next++;
+        for (auto& pool : _pools)
+            pool->compact(remap);
+        for (auto& sys : _systems)
+            sys.second->compact(remap);
+        _hierarchy.compact(remap);
+        for (auto& index : _spatial)
+            index.second->grid().clear();
+        _entities.clear();
+        for (EntityId id = 0; id < next; id++)
+            _entities.at(id) = true;
+        _removedEntitiesIds = decltype(_removedEntitiesIds)();
+        _lastUsedEntity.id = _lastUsedEntity.id < remap.size()
+            ? remap[_lastUsedEntity.id]
+            : InvalidEntityId;
+        _lastEntityId = next;
+        syncSpatial();
+        if (f)
+            f([&remap](const Entity& e) {
+                return Entity(e.id < remap.size() ? remap[e.id] : InvalidEntityId);
+            });
+        return *this;
     }
 
     /**
-     * @brief Returns the Component of the last used Entity
-     * @tparam T The type of the component
-     * @return T& The component of the entity
+     * @brief Copies every pool, system, the hierarchy and the entity
+     *        allocator in the given snapshot (bulk copyable pools are copied
+     *        with a single memcpy)
+     * @param s The snapshot to write to (its buffers are reused)
      */
-    template <typename T>
-    inline T& get() { return get<T>(_lastUsedEntity, false); }
+    inline void snapshot(Snapshot& s) const
+    {
+        s._lastEntityId = _lastEntityId;
+        s._removedEntitiesIds = _removedEntitiesIds;
+        s._lastUsedEntity = _lastUsedEntity.id;
+        s._pools.resize(_pools.size());
+        for (std::size_t i = 0; i < _pools.size(); i++)
+            _pools[i]->save(s._pools[i]);
+        for (auto it = s._systems.begin(); it != s._systems.end();)
+            it = std::any_of(_systems.begin(), _systems.end(),
+                     [&it](const auto& sys) { return sys.first == it->first; })
+                ? std::next(it)
+                : s._systems.erase(it);
+        for (const auto& sys : _systems)
+            sys.second->save(s._systems[sys.first]);
+        _hierarchy.save(s._hierarchy);
+    }
 
     /**
-     * @brief Creates a new Entity and returns it
-     *        It sets the last used Entity to the newly created one
-     * @return Entity The new Entity
+     * @brief Puts the registry back in the state of the given snapshot
+     *        Pools registered after the snapshot are emptied and systems
+     *        added after it are rebuilt from the components
+     * @param s The snapshot to read from
+     * @return registry& The registry to chain the calls
      */
-    inline Entity newEntity()
+    inline registry& restore(const Snapshot& s)
     {
-        if (_removedEntitiesIds.empty()) {
-            _lastUsedEntity.id = _lastEntityId;
-            if (_lastUsedEntity.id + 1 >= _entities.size()) {
-                _entities.resize(REGISTRY_ENTITY_SIZE);
-            }
-            _entities.set(new priv::SparseArray<Component>(_componentArraySize),
-                _lastUsedEntity.id);
-            _lastEntityId++;
-            return _lastUsedEntity;
+        if (s._pools.size() > _pools.size())
+            throw Error("restore(): the snapshot has more pools than the registry");
+        for (std::size_t i = 0; i < s._pools.size(); i++)
+            if (s._pools[i] != nullptr && _pools[i]->accepts(*s._pools[i]) == false)
+                throw Error("restore(): the snapshot does not match the pools of the registry");
+        _reserved = 0;
+        if (_lastEntityId != s._lastEntityId
+            || _removedEntitiesIds.ids() != s._removedEntitiesIds.ids()) {
+            for (EntityId id = 0; id < _lastEntityId; id++)
+                _entities.reset(id);
+            for (EntityId id = 0; id < s._lastEntityId; id++)
+                _entities.at(id) = true;
+            for (const auto& id : s._removedEntitiesIds.ids())
+                _entities.reset(id);
+            _lastEntityId = s._lastEntityId;
+            _removedEntitiesIds = s._removedEntitiesIds;
         }
-        _lastUsedEntity = Entity(_removedEntitiesIds.top());
-        _entities.set(new priv::SparseArray<Component>(_componentArraySize),
-            _lastUsedEntity.id);
-        _removedEntitiesIds.pop();
-        return _lastUsedEntity;
+        _lastUsedEntity.id = s._lastUsedEntity;
+        for (std::size_t i = 0; i < _pools.size(); i++) {
+            if (i < s._pools.size() && s._pools[i] != nullptr)
+                _pools[i]->restore(*s._pools[i]);
+            else
+                _pools[i]->clear();
+        }
+        for (auto& sys : _systems) {
+            const auto it = s._systems.find(sys.first);
+            if (it != s._systems.end())
+                sys.second->load(it->second);
+            else
+                _rebuildSystem(*sys.second);
+        }
+        _hierarchy.load(s._hierarchy);
+        return *this;
     }
 
     /**
-     * @brief Removes the given Entity
-     * @param e The entity to remove
+     * @brief Applies the changes of a delta (see silva::diff)
+     *        The registry should be in the state of the older snapshot of
+     *        the delta and every component type of the delta must be
+     *        registered (see registerComponent)
+     * @param d The delta to apply
      * @return registry& The registry to chain the calls
      */
-    inline registry& removeEntity(const Entity& e)
+    inline registry& apply(const Delta& d)
     {
-        _entities.unset(e.id);
-        for (auto& sys : _systems)
-            sys.second->onEntityDelete(e);
-        if (e.id == _lastEntityId) {
-            _lastEntityId--;
-            return *this;
+        std::vector<EntityId> touched(d._created);
+
+        _reserved = 0;
+        for (const auto& id : d._destroyed)
+            removeEntity(Entity(id));
+        for (const auto& id : d._created)
+            _entities.at(id) = true;
+        for (const auto& pool : d._pools) {
+            auto it = std::find_if(_pools.begin(), _pools.end(),
+                [&pool](const auto& p) { return p->hash() == pool.type; });
+            if (it == _pools.end())
+                throw Error("apply(): unregistered component (hash "
+                    + std::to_string(pool.type) + ")");
+            if ((*it)->stride() != pool.stride)
+                throw Error("apply(): component size mismatch (hash "
+                    + std::to_string(pool.type) + ")");
+            for (const auto& id : pool.removed)
+                if ((*it)->has(id)) {
+                    (*it)->remove(id);
+                    touched.push_back(id);
+                }
+            for (std::size_t i = 0; i < pool.changed.size(); i++)
+                if ((*it)->assign(pool.changed[i], pool.data.data() + i * pool.stride))
+                    touched.push_back(pool.changed[i]);
         }
-        _removedEntitiesIds.push(e.id);
+        _lastEntityId = d._lastEntityId;
+        _removedEntitiesIds = priv::IdHeap();
+        for (const auto& id : d._freeIds)
+            _removedEntitiesIds.push(id);
+        for (auto& sys : _systems)
+            for (const auto& id : touched)
+                sys.second->onEntityUpdate(*this, Entity(id));
+        // deltas do not carry the hierarchy, dead ids must not stay in it
+        _hierarchy.prune([this](const Entity& e) { return _alive(e.id); });
         return *this;
     }
 
     /**
-     * @brief add a new System of the given tag
-     * @param tag The tag of the system
-     * @param updateLast Used to avoid passing the system each time as a
-     * parameter (if true, _lastUsedSystem is updated to sys)
-     * @tparam T The first type of the system dependencies
-     * @tparam Args... The other types of the dependencies
-     * @return registry& The registry to chain the calls
+     * @brief Collects the memory and occupancy of every pool and system
+     * @return RegistryStats The stats of the registry
      */
-    template <typename T, typename... Args>
-    inline registry& addSystem(const std::string& tag, const bool& updateLast = true)
+    inline RegistryStats stats() const
     {
-        if (updateLast)
-            _lastUsedSystem = tag;
-        _systems[tag] = std::make_unique<priv::System>();
-        return _addSystemDeps<T, Args...>(*_systems.at(tag));
+        RegistryStats s;
+        s.entities = _lastEntityId - _removedEntitiesIds.size();
+        s.pools.reserve(_pools.size());
+        for (const auto& pool : _pools)
+            s.pools.push_back(pool->stats());
+        s.systems = systemStats();
+        return s;
     }
 
     /**
-     * @brief add a new System of the given tag
-     * @param tag The tag of the system
-     * @tparam T The first type of the system dependencies
-     * @tparam Args... The other types of the dependencies
-     * @return registry& The registry to chain the calls
+     * @brief Collects the cost of the last update of every system, in the
+     *        order they run (cheaper than stats() to call every frame)
+     * @return std::vector<SystemStats> The stats of each system
      */
-    template <typename T, typename... Args>
-    inline registry& addSystemDeps(
-        const std::string& tag, const bool& updateLast = true)
+    inline std::vector<SystemStats> systemStats() const
     {
-        if (updateLast)
-            _lastUsedSystem = tag;
-        return _addSystemDeps<T, Args...>(*_systems.at(tag));
+        std::vector<SystemStats> s;
+
+        s.reserve(_systems.size());
+        for (const auto& sys : _systems)
+            s.push_back(SystemStats { sys.first, sys.second->size(), sys.second->lastUpdate(),
+                sys.second->stage(), sys.second->lastUpdated() });
+        return s;
     }
 
     /**
-     * @brief add deps to the last added System
-     * @tparam T The first type of the system dependencies
-     * @tparam Args... The other types of the dependencies
-     * @return registry& The registry to chain the calls
+     * @brief Get the calls to get, has, emplace and view made during the last
+     *        frame, per component and per system (a frame ends at each
+     *        update() or update(Stage::PreUpdate))
+     *        Only counted when SILVA_COUNTERS is 1 (empty otherwise); the
+     *        const accessors are not counted so they stay safe for
+     *        concurrent readers
+     * @return const std::vector<AccessStats>& The calls of the last frame
      */
+    inline const std::vector<AccessStats>& accessStats() const { return _accessStats; }
+
     template <typename T, typename... Args>
-    inline registry& addSystemDeps()
+    inline View<T, Args...> view()
     {
-        return addSystemDeps<T, Args...>(_lastUsedSystem, false);
+#if SILVA_COUNTERS
+        _count(_cti<T>(), &priv::AccessCounts::views);
+        (_count(_cti<Args>(), &priv::AccessCounts::views), ...);
+#endif
+        return View<T, Args...>(*this);
     }
 
     /**
-     * @brief Removes the given System
-     * @param tag The tag of the system
-     * @return registry& The registry to chain the calls
+     * @brief Creates a read-only view (the components must be const)
+     *        Does not modify the registry, so several threads can build and
+     *        walk views at the same time as long as nobody writes to it
+     *        The view is not allocated from the resource of the registry
+     *        (an Arena is not thread safe) but from the given one
+     * @tparam T The first type of the components
+     * @tparam Args... The other types of the components
+     * @param resource The resource the view is allocated from (must be
+     *        thread safe if shared by several readers)
+     * @return View<T, Args...> The view
      */
-    inline registry& removeSystem(const std::string& tag)
+    template <typename T, typename... Args>
+    inline View<T, Args...> view(
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const
     {
-        _systems.erase(tag);
-        return *this;
+        return View<T, Args...>(*this, resource);
     }
+};
+
+/**
+ * @brief A ring of the snapshots of the last N frames (for rollback)
+ *        The snapshots are reused so capturing does not allocate once the
+ *        ring is warm
+ */
+class SnapshotRing {
+private:
+    /**
+     * @brief The snapshots
+     */
+    std::vector<Snapshot> _snapshots;
 
     /**
-     * @brief Set the updater function of the given System
-     * @param tag The tag of the system
-     * @param f The function to set
-     * @param updateLast Used to avoid passing the system each time as a
-     * parameter (if true, _lastUsedSystem is updated to sys)
-     * @return registry& The registry to chain the calls
+     * @brief The frame held by each snapshot
      */
-    inline registry& setSystemUpdate(const std::string& tag, const SystemUpdater& f,
-        const bool& updateLast = true)
-    {
-        if (updateLast)
-            _lastUsedSystem = tag;
-        _systems.at(tag)->setSystemUpdate(f);
-        return *this;
-    }
+    std::vector<std::size_t> _frames;
 
     /**
-     * @brief Set the updater function of the last added System
-     * @param f The function to set
-     * @return registry& The registry to chain the calls
+     * @brief Get the slot of the given frame
+     * @param frame The frame
+     * @return std::size_t The slot in the ring
      */
-    inline registry& setSystemUpdate(const SystemUpdater& f)
+    inline std::size_t _slot(const std::size_t& frame) const { return frame % _snapshots.size(); }
+
+public:
+    /**
+     * @brief Construct a new Snapshot Ring
+     * @param size The number of frames kept
+     */
+    inline SnapshotRing(const std::size_t& size)
+        : _snapshots(size ? size : 1)
+        , _frames(size ? size : 1, static_cast<std::size_t>(-1))
     {
-        return setSystemUpdate(_lastUsedSystem, f, false);
     }
 
     /**
-     * @brief Calls emplace on the last used Entity (Is used to chain emplace
-     * calls)
-     * @tparam T The type of the component
-     * @tparam Args... The types of the arguments
-     * @param args The arguments of the emplace call
-     * @return registry& The registry to chain the calls
+     * @brief Capture the registry as the given frame (overwrites the oldest)
+     * @param r The registry
+     * @param frame The frame number
      */
-    template <typename T, typename... Args>
-    inline registry& emplace_r(Args&&... args)
+    inline void capture(const registry& r, const std::size_t& frame)
     {
-        return emplace<T, Args...>(
-            _lastUsedEntity, std::forward<Args>(args)...);
+        r.snapshot(_snapshots[_slot(frame)]);
+        _frames[_slot(frame)] = frame;
     }
 
     /**
-     * @brief Calls emplace on the given Entity (Used as first emplace call)
-     * @tparam T The type of the component
-     * @tparam Args... The types of the arguments
-     * @param e The entity to emplace the component on
-     * @param args The arguments of the emplace call
-     * @return registry& The registry to chain the calls
+     * @brief Tells if the given frame is still in the ring
+     * @param frame The frame number
+     * @return true The frame can be restored
+     * @return false The frame is too old or was never captured
      */
-    template <typename T, typename... Args>
-    inline registry& emplace(const Entity& e, Args&&... args)
+    inline bool has(const std::size_t& frame) const
     {
-        _lastUsedEntity = e;
-        _entities.get(e.id).set(
-            new Component((T) { std::forward<Args>(args)... }), _cti<T>());
-        for (auto& sys : _systems)
-            sys.second->onEntityUpdate(*this, e);
-        return *this;
+        return _frames[_slot(frame)] == frame;
     }
 
     /**
-     * @brief Updates all the systems in the registry
-     * @return registry& The registry to chain the calls
+     * @brief Restore the registry to the given frame
+     * @param r The registry
+     * @param frame The frame number
      */
-    inline registry& update()
+    inline void restore(registry& r, const std::size_t& frame) const
     {
-        for (auto& sys : _systems)
-            sys.second->update(*this);
-        return *this;
+        r.restore(at(frame));
     }
 
     /**
-     * @brief Returns the current max Entity id
-     * @return EntityId The max Entity id
+     * @brief Get the snapshot of the given frame
+     * @param frame The frame number
+     * @return const Snapshot& The snapshot
      */
-    inline const EntityId& entitiesCount() const { return _lastEntityId; }
-
-    template <typename T, typename... Args>
-    inline View<T, Args...> view()
+    inline const Snapshot& at(const std::size_t& frame) const
     {
-        return View<T, Args...>(*this);
+        if (has(frame) == false)
+            throw Error("SnapshotRing::at(" + std::to_string(frame) + "): frame not available");
+        return _snapshots[_slot(frame)];
     }
+
+    /**
+     * @brief Get the number of frames kept
+     * @return std::size_t The size of the ring
+     */
+    inline std::size_t size() const { return _snapshots.size(); }
 };
 
 namespace priv {
@@ -1223,15 +6543,59 @@ namespace priv {
      */
     inline void System::onEntityUpdate(registry& r, const Entity& e)
     {
-        const auto it = std::find(_entities.begin(), _entities.end(), e);
+        const bool member = isMember(e);
         for (const auto& dep : _dependencies)
             if (r.has(e, dep, false) == false) {
-                if (it != _entities.end())
-                    _entities.erase(it);
+                if (member)
+                    _erase(e);
                 return;
             }
-        if (it == _entities.end())
+        if (member == false) {
+            _members.at(e.id) = true;
             _entities.push_back(e);
+        }
+    }
+
+    inline void System::onEntitiesCreate(registry& r, const std::vector<Entity>& es)
+    {
+        if (es.empty())
+            return;
+        for (const auto& dep : _dependencies)
+            if (r.has(es.front(), dep, false) == false)
+                return;
+        _entities.reserve(_entities.size() + es.size());
+        for (const auto& e : es) {
+            _members.at(e.id) = true;
+            _entities.push_back(e);
+        }
+    }
+
+    template <typename T>
+    inline void PrefabComponent<T>::spawn(registry& r, const std::vector<Entity>& es) const
+    {
+        r._pool<T>().emplaceMany(es, _value);
+    }
+
+    template <typename T>
+    inline void SpatialIndex<T>::sync(const registry& r)
+    {
+        const auto* pool = r._find<T>();
+        std::vector<Entity> lost;
+
+        if (pool == nullptr) {
+            _grid.clear();
+            return;
+        }
+        _grid.each([&pool, &lost](const Entity& e, const AABB&) {
+            if (pool->has(e.id) == false)
+                lost.push_back(e);
+        });
+        for (const auto& e : lost)
+            _grid.remove(e);
+        const auto& owners = pool->entities();
+        const auto& data = pool->data();
+        for (std::size_t i = 0; i < owners.size(); i++)
+            _grid.set(Entity(owners[i]), _bounds(data[i]));
     }
 
 }
@@ -1259,6 +6623,7 @@ public:
      * @param r The registry to base the view on
      */
     inline View(registry& r)
+        : _tuple(r.resource())
     {
         std::vector<ComponentIndex> deps;
         r.getDepsList<T&, Args&...>(deps);
@@ -1272,13 +6637,41 @@ public:
                 }
             if (valid) {
                 Entity e(id);
-                _tuple.push_back(
-                    std::make_unique<std::tuple<Entity, T&, Args&...>>(
-                        e, r.get<T>(e), r.get<Args&>(e)...));
+                _tuple.emplace_back(e, r._pool<T>().get(id), r._pool<Args>().get(id)...);
             }
         }
     }
 
+    /**
+     * @brief Construct a new read-only View object (the entities are in the
+     *        storage order of the first component)
+     * @param r The registry to base the view on
+     * @param resource The resource the view is allocated from (never the one
+     *        of the registry, concurrent readers would share it)
+     */
+    inline View(const registry& r,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : _tuple(resource)
+    {
+        static_assert(std::is_const_v<T> && (std::is_const_v<Args> && ...),
+            "A view on a const registry can only hold const components");
+        const auto* pool = r._find<T>();
+        const auto others = std::make_tuple(r._find<Args>()...);
+        if (pool == nullptr
+            || std::apply([](const auto*... p) { return ((p == nullptr) || ...); }, others))
+            return;
+
+        const EntityId* owners = pool->owners();
+        for (std::size_t i = 0; i < pool->size(); i++) {
+            const EntityId& id = owners[i];
+            std::apply([this, &pool, &id](const auto*... p) {
+                if ((p->has(id) && ...))
+                    _tuple.emplace_back(Entity(id), pool->get(id), p->get(id)...);
+            },
+                others);
+        }
+    }
+
     /**
      * @brief Apply the given function to each entity in the view
      * @param f The function to apply
@@ -1288,7 +6681,7 @@ public:
     inline void each(const F& f)
     {
         for (const auto& t : _tuple)
-            f(std::get<1>(*t), std::forward<Args&>(std::get<2>(*t))...);
+            std::apply([&f](const Entity&, T& c, Args&... cs) { f(c, cs...); }, t);
     }
 
     /**
@@ -1300,9 +6693,7 @@ public:
     inline void each2(const F& f)
     {
         for (const auto& t : _tuple)
-            f(std::get<0>(*t),
-                std::get<1>(*t),
-                std::forward<Args&>(std::get<2>(*t))...);
+            std::apply(f, t);
     }
 
     template <typename F>
@@ -1321,7 +6712,7 @@ public:
         /**
          * @brief A reference to the view container
          */
-        const ViewContainer<T, Args...>& _tuple;
+        ViewContainer<T, Args...>& _tuple;
 
     public:
         /**
@@ -1329,7 +6720,7 @@ public:
          * @param tuple A reference to the view
          * @param i The starting index
          */
-        inline Iterator(const ViewContainer<T, Args...>& tuple, std::size_t i)
+        inline Iterator(ViewContainer<T, Args...>& tuple, std::size_t i)
             : _i(i)
             , _tuple(tuple)
         {
@@ -1430,7 +6821,7 @@ public:
         inline ViewValue<T, Args...>& operator*()
         {
             try {
-                return *_tuple.at(_i);
+                return _tuple.at(_i);
             } catch (const std::exception& e) {
                 throw Error(
                     std::string("operator*(): invalid iterator: ") + e.what());
@@ -1446,7 +6837,7 @@ public:
         operator*() const
         {
             try {
-                return *_tuple.at(_i);
+                return _tuple.at(_i);
             } catch (const std::exception& e) {
                 throw Error(
                     std::string("operator*(): invalid iterator: ") + e.what());
@@ -1484,6 +6875,413 @@ public:
     inline Iterator end() { return Iterator(_tuple, _tuple.size()); }
 };
 
+/**
+ * @brief Upper bound of the entity count of a file read by load_mmap (the
+ *        entity bitmap is committed up to it, a corrupt count must not
+ *        allocate unbounded memory)
+ */
+#ifndef SILVA_MAX_FILE_ENTITIES
+#define SILVA_MAX_FILE_ENTITIES (std::uint64_t(1) << 28)
+#endif
+
+namespace priv {
+
+    /**
+     * @brief Alignment of every block of a registry file
+     */
+    static constexpr std::size_t FileAlignment = 64;
+
+    /**
+     * @brief Header of a registry file
+     */
+    struct FileHeader {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t idSize;
+        std::uint64_t lastEntityId;
+        std::uint64_t freeCount;
+        std::uint64_t freeOffset;
+        std::uint64_t poolCount;
+    };
+
+    /**
+     * @brief Header of a pool block in a registry file
+     */
+    struct PoolHeader {
+        std::uint64_t typeHash;
+        std::uint64_t count;
+        std::uint64_t stride;
+        std::uint64_t ownersOffset;
+        std::uint64_t dataOffset;
+    };
+
+    /**
+     * @brief Read only view of a whole file (mapped in memory when the
+     *        platform allows it, read in a buffer otherwise)
+     */
+    class MappedFile {
+    private:
+        /**
+         * @brief The content of the file
+         */
+        const unsigned char* _data = nullptr;
+
+        /**
+         * @brief The size of the file
+         */
+        std::size_t _size = 0;
+
+#if defined(__unix__) || defined(__APPLE__)
+        /**
+         * @brief Tells if _data is a mapping
+         */
+        bool _mapped = false;
+#endif
+
+        /**
+         * @brief The content of the file when it could not be mapped
+         */
+        std::vector<unsigned char> _buffer;
+
+    public:
+        /**
+         * @brief Map the given file
+         * @param path The path of the file
+         */
+        inline MappedFile(const std::string& path)
+        {
+#if defined(__unix__) || defined(__APPLE__)
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            struct stat st;
+            if (fd != -1 && ::fstat(fd, &st) == 0 && st.st_size > 0) {
+                void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    _data = static_cast<const unsigned char*>(p);
+                    _size = st.st_size;
+                    _mapped = true;
+                }
+            }
+            if (fd != -1)
+                ::close(fd);
+            if (_mapped)
+                return;
+#endif
+            std::ifstream file(path, std::ios::binary);
+            if (!file)
+                throw Error("MappedFile(" + path + "): cannot open the file");
+            _buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            _data = _buffer.data();
+            _size = _buffer.size();
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+         * @brief Unmap the file
+         */
+        inline ~MappedFile()
+        {
+#if defined(__unix__) || defined(__APPLE__)
+            if (_mapped)
+                ::munmap(const_cast<unsigned char*>(_data), _size);
+#endif
+        }
+
+        /**
+         * @brief Get the content of the file
+         * @return const unsigned char* The content
+         */
+        inline const unsigned char* data() const { return _data; }
+
+        /**
+         * @brief Get the size of the file
+         * @return std::size_t The size
+         */
+        inline std::size_t size() const { return _size; }
+    };
+
+}
+
+/**
+ * @brief Writes every bulk copyable pool and the entity allocator of the
+ *        registry in a binary file
+ *        Each pool is an aligned contiguous block of owners followed by an
+ *        aligned block of components, described by a header (type hash,
+ *        count, stride) so it can be loaded back with a single copy
+ *        Pools of types that are not trivially copyable are not saved
+ * @param r The registry to save
+ * @param path The path of the file
+ */
+inline void save(const registry& r, const std::string& path)
+{
+    std::vector<const priv::IPool*> pools;
+    for (const auto& pool : r._pools)
+        if (pool->stride() != 0)
+            pools.push_back(pool.get());
+
+    const auto align = [](const std::uint64_t& n) {
+        return (n + priv::FileAlignment - 1) & ~static_cast<std::uint64_t>(priv::FileAlignment - 1);
+    };
+    const std::vector<EntityId>& freeIds = r._removedEntitiesIds.ids();
+    priv::FileHeader header = { { 'S', 'L', 'V', 'A' }, 1, sizeof(EntityId),
+        r._lastEntityId, freeIds.size(), 0, pools.size() };
+    std::vector<priv::PoolHeader> headers(pools.size());
+    std::uint64_t offset = align(sizeof(header) + headers.size() * sizeof(priv::PoolHeader));
+
+    header.freeOffset = offset;
+    offset = align(offset + freeIds.size() * sizeof(EntityId));
+    for (std::size_t i = 0; i < pools.size(); i++) {
+        headers[i].typeHash = pools[i]->hash();
+        headers[i].count = pools[i]->size();
+        headers[i].stride = pools[i]->stride();
+        headers[i].ownersOffset = offset;
+        offset = align(offset + headers[i].count * sizeof(EntityId));
+        headers[i].dataOffset = offset;
+        offset = align(offset + headers[i].count * headers[i].stride);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw Error("save(" + path + "): cannot open the file");
+    const auto write = [&file](const void* data, const std::uint64_t& size, const std::uint64_t& at) {
+        static const char zeros[priv::FileAlignment] = {};
+        for (std::uint64_t pos = file.tellp(); pos < at; pos += priv::FileAlignment)
+            file.write(zeros, std::min<std::uint64_t>(priv::FileAlignment, at - pos));
+        if (size)
+            file.write(static_cast<const char*>(data), size);
+    };
+    write(&header, sizeof(header), 0);
+    write(headers.data(), headers.size() * sizeof(priv::PoolHeader), sizeof(header));
+    write(freeIds.data(), freeIds.size() * sizeof(EntityId), header.freeOffset);
+    for (std::size_t i = 0; i < pools.size(); i++) {
+        write(pools[i]->owners(), headers[i].count * sizeof(EntityId), headers[i].ownersOffset);
+        write(pools[i]->raw(), headers[i].count * headers[i].stride, headers[i].dataOffset);
+    }
+    write(nullptr, 0, offset);
+    if (!file)
+        throw Error("save(" + path + "): failed to write the file");
+}
+
+/**
+ * @brief Loads a file written by save() in the registry
+ *        The file is mapped in memory and each pool block is copied in its
+ *        pool at once, then the systems are rebuilt
+ *        Every component type of the file must be registered in the registry
+ *        (see registry::registerComponent) and pools missing from the file
+ *        are emptied
+ *        The whole file is validated first: a corrupt or mismatching file
+ *        throws an Error and leaves the registry unchanged
+ * @param r The registry to load into
+ * @param path The path of the file
+ */
+inline void load_mmap(registry& r, const std::string& path)
+{
+    const priv::MappedFile file(path);
+    const auto fail = [&path](const std::string& msg) {
+        return Error("load_mmap(" + path + "): " + msg);
+    };
+    const auto check = [&file, &fail](const std::uint64_t& offset, const std::uint64_t& size) {
+        if (offset > file.size() || size > file.size() - offset)
+            throw fail("truncated file");
+    };
+
+    const auto size = [&fail](const std::uint64_t& n, const std::uint64_t& stride) {
+        if (stride != 0 && n > std::numeric_limits<std::uint64_t>::max() / stride)
+            throw fail("corrupt block size");
+        return n * stride;
+    };
+    const auto aligned = [&fail](const std::uint64_t& offset) {
+        if (offset % priv::FileAlignment != 0)
+            throw fail("misaligned block");
+    };
+    const auto id = [](const unsigned char* ids, const std::uint64_t& i) {
+        EntityId e;
+        std::memcpy(&e, ids + i * sizeof(EntityId), sizeof(EntityId));
+        return e;
+    };
+
+    // everything is validated before the registry is touched
+    check(0, sizeof(priv::FileHeader));
+    priv::FileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, "SLVA", 4) != 0 || header.version != 1)
+        throw fail("not a registry file");
+    if (header.idSize != sizeof(EntityId))
+        throw fail("entity ids are " + std::to_string(header.idSize) + " bytes wide");
+    if (header.lastEntityId > SILVA_MAX_FILE_ENTITIES)
+        throw fail(std::to_string(header.lastEntityId) + " entities (max " + std::to_string(SILVA_MAX_FILE_ENTITIES) + ")");
+    if (header.freeCount > header.lastEntityId)
+        throw fail("more free ids than entities");
+    check(sizeof(header), size(header.poolCount, sizeof(priv::PoolHeader)));
+    aligned(header.freeOffset);
+    check(header.freeOffset, size(header.freeCount, sizeof(EntityId)));
+    const unsigned char* freeIds = file.data() + header.freeOffset;
+    std::vector<priv::PoolHeader> headers(header.poolCount);
+    if (header.poolCount)
+        std::memcpy(headers.data(), file.data() + sizeof(header), headers.size() * sizeof(priv::PoolHeader));
+
+    std::vector<bool> dead(header.lastEntityId, false);
+    for (std::uint64_t i = 0; i < header.freeCount; i++) {
+        const EntityId e = id(freeIds, i);
+        if (e >= header.lastEntityId || dead[e])
+            throw fail("corrupt free id " + std::to_string(e));
+        dead[e] = true;
+    }
+
+    std::vector<priv::IPool*> targets(headers.size(), nullptr);
+    std::vector<bool> loaded(r._pools.size(), false);
+    std::vector<bool> owned(header.lastEntityId, false);
+    for (std::size_t i = 0; i < headers.size(); i++) {
+        const priv::PoolHeader& h = headers[i];
+        auto it = std::find_if(r._pools.begin(), r._pools.end(),
+            [&h](const auto& pool) { return pool->hash() == h.typeHash; });
+        if (it == r._pools.end())
+            throw fail("unregistered component (hash " + std::to_string(h.typeHash) + ")");
+        if ((*it)->stride() != h.stride)
+            throw fail("component size mismatch (hash " + std::to_string(h.typeHash) + ")");
+        if (loaded[it - r._pools.begin()])
+            throw fail("duplicated component (hash " + std::to_string(h.typeHash) + ")");
+        if (h.count > header.lastEntityId)
+            throw fail("more components than entities (hash " + std::to_string(h.typeHash) + ")");
+        aligned(h.ownersOffset);
+        aligned(h.dataOffset);
+        check(h.ownersOffset, size(h.count, sizeof(EntityId)));
+        check(h.dataOffset, size(h.count, h.stride));
+        const unsigned char* owners = file.data() + h.ownersOffset;
+        for (std::uint64_t j = 0; j < h.count; j++) {
+            const EntityId e = id(owners, j);
+            if (e >= header.lastEntityId || dead[e] || owned[e])
+                throw fail("corrupt owner id " + std::to_string(e) + " (hash " + std::to_string(h.typeHash) + ")");
+            owned[e] = true;
+        }
+        for (std::uint64_t j = 0; j < h.count; j++)
+            owned[id(owners, j)] = false;
+        targets[i] = it->get();
+        loaded[it - r._pools.begin()] = true;
+    }
+
+    for (std::size_t i = 0; i < headers.size(); i++)
+        targets[i]->load(reinterpret_cast<const EntityId*>(file.data() + headers[i].ownersOffset),
+            file.data() + headers[i].dataOffset, headers[i].count);
+    for (std::size_t i = 0; i < r._pools.size(); i++)
+        if (loaded[i] == false)
+            r._pools[i]->clear();
+
+    for (EntityId id = 0; id < r._lastEntityId; id++)
+        r._entities.reset(id);
+    for (EntityId id = 0; id < header.lastEntityId; id++)
+        r._entities.at(id) = true;
+    r._removedEntitiesIds = priv::IdHeap();
+    for (std::uint64_t i = 0; i < header.freeCount; i++) {
+        r._entities.reset(id(freeIds, i));
+        r._removedEntitiesIds.push(id(freeIds, i));
+    }
+    r._lastEntityId = header.lastEntityId;
+    r._reserved = 0;
+    r._lastUsedEntity = Entity(0);
+    for (auto& sys : r._systems)
+        r._rebuildSystem(*sys.second);
+    r._hierarchy.prune([&r](const Entity& e) { return r._alive(e.id); });
+}
+
+/**
+ * @brief Moves an entity and its components to another registry (e.g. from
+ *        one streamed chunk to the next), pool to pool: each component is
+ *        moved into the pool of the same type of the destination, which is
+ *        created if needed
+ *        The entity leaves the systems, hierarchy and spatial indexes of
+ *        from (its children stay there as roots) and gets a new id in to;
+ *        components holding Entity fields must be fixed by the caller
+ *        Throws before changing anything if a component type has another
+ *        layout in the destination registry
+ *        Neither registry may be updated by another thread meanwhile
+ * @param from The registry owning the entity
+ * @param to The registry receiving the entity
+ * @param e The entity to move
+ * @return Entity The entity in the destination registry
+ */
+inline Entity move_entity(registry& from, registry& to, const Entity& e)
+{
+    if (&from == &to)
+        return e;
+    from.commit_reserved();
+    if (from._alive(e.id) == false)
+        throw Error("move_entity(): " + std::to_string(e.id) + " is not alive");
+    for (const auto& pool : from._pools) {
+        if (pool->has(e.id) == false)
+            continue;
+        const auto it = std::find_if(to._pools.begin(), to._pools.end(),
+            [hash = pool->hash()](const auto& p) { return p->hash() == hash; });
+        if (it == to._pools.end())
+            continue;
+        const auto& dst = **it;
+        if (dst.stride() != pool->stride() || (dst.stride() == 0 && typeid(dst) != typeid(*pool)))
+            throw Error("move_entity(): the component " + std::to_string(pool->hash())
+                + " has another layout in the destination registry");
+    }
+    const Entity moved = to.newEntity();
+
+    for (auto& pool : from._pools) {
+        if (pool->has(e.id) == false)
+            continue;
+        auto it = std::find_if(to._pools.begin(), to._pools.end(),
+            [hash = pool->hash()](const auto& p) { return p->hash() == hash; });
+        if (it == to._pools.end()) {
+            to._pools.push_back(pool->create(to._resource));
+            it = to._pools.end() - 1;
+        }
+        pool->moveTo(e.id, **it, moved.id);
+    }
+    for (auto& sys : to._systems)
+        sys.second->onEntityUpdate(to, moved);
+    from.removeEntity(e);
+    return moved;
+}
+
+/**
+ * @brief Updates several independent registries (worlds) at once, each on
+ *        its own thread (the first one on the calling thread)
+ *        The systems of a world must only touch their own world and the
+ *        registries must use thread-safe memory resources (the default
+ *        one is, an Arena per world works too)
+ *        The first exception thrown by a world is rethrown once they are
+ *        all updated
+ * @param worlds The registries to update
+ */
+inline void update_parallel(const std::vector<registry*>& worlds)
+{
+    std::vector<std::exception_ptr> errors(worlds.size());
+    std::vector<std::thread> threads;
+    struct Joiner {
+        std::vector<std::thread>& threads;
+        ~Joiner()
+        {
+            for (auto& thread : threads)
+                if (thread.joinable())
+                    thread.join();
+        }
+    } joiner { threads };
+    const auto run = [&worlds, &errors](const std::size_t& i) {
+        try {
+            worlds[i]->update();
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    threads.reserve(worlds.size());
+    for (std::size_t i = 1; i < worlds.size(); i++)
+        threads.emplace_back(run, i);
+    if (worlds.empty() == false)
+        run(0);
+    for (auto& thread : threads)
+        thread.join();
+    for (const auto& error : errors)
+        if (error)
+            std::rethrow_exception(error);
+}
+
 template <typename R, typename... Args>
 inline R& get(ViewValue<Args...>& h) { return std::get<R&>(h); }
 
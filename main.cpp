@@ -33,15 +33,13 @@ class TestState : public engine::State
         }
     }
 
-    void update() override
-    {
-        ImGui::BeginLock lock("Test");
-        ImGui::Text("Hello World the first");
-    }
+    ENGINE_EMPTY_STATE_UPDATE;
 
     void draw(sf::RenderWindow &window) override
     {
         window.draw(_rectangle);
+        ImGui::BeginLock lock("Test");
+        ImGui::Text("Hello World the first");
     }
 
     ENGINE_EMPTY_STATE_STOP;
@@ -67,8 +65,11 @@ class TestState2 : public engine::State
         }
     }
 
-    void update() override
+    ENGINE_EMPTY_STATE_UPDATE;
+
+    void draw(sf::RenderWindow &window) override
     {
+        (void)window;
         bool some;
         ImGui::BeginLock lockBegin("Test2", &some, ImGuiWindowFlags_MenuBar);
         {
@@ -89,8 +90,6 @@ class TestState2 : public engine::State
         }
     }
 
-    ENGINE_EMPTY_STATE_DRAW;
-
     ENGINE_EMPTY_STATE_STOP;
 };
 